@@ -0,0 +1,23 @@
+#include "can_bench.hpp"
+#include "rcc.hpp"
+
+#include <f3/console.hpp>
+
+struct HardwareConfig {
+  using RCCConfig = CANMonitor::BaremetalRCC;
+
+  using ConsoleTx = stm32f3::GPIO<0, 2>;
+  using ConsoleRx = stm32f3::GPIO<0, 15>;
+  static constexpr uint32_t kConsoleBaudrate = 921600;
+  static constexpr uint32_t kConsoleUARTAltFn = 7;
+  static constexpr uint32_t kConsoleUARTId = 2;
+  static constexpr size_t kConsoleRxBufSize = 0;
+};
+
+int main() {
+  stm32::InitRCC();
+  stm32f3::Console<HardwareConfig>::Init();
+
+  CANMonitor::CANBench bench;
+  bench.Main();
+}
@@ -5,6 +5,7 @@
 #include <f3/peripherals/can.hpp>
 #include <f3/peripherals/gpio.hpp>
 #include "rcc.hpp"
+#include "schedule.hpp"
 
 namespace CANMonitor {
 //* Configuration
@@ -18,6 +19,10 @@ class Handler {
     if (handle_error_)
       handle_error_();
   }
+  static void HandleTxComplete(stm32f3::can::CANMessage const& msg) {
+    if (handle_tx_complete_)
+      handle_tx_complete_(msg);
+  }
 
   static void Init(
       std::function<void(int fifo, stm32f3::can::CANMessage const& msg)>
@@ -27,18 +32,26 @@ class Handler {
     handle_error_ = handle_error;
   }
 
+  static void InitTxComplete(
+      std::function<void(stm32f3::can::CANMessage const& msg)>
+          handle_tx_complete) {
+    handle_tx_complete_ = handle_tx_complete;
+  }
+
  private:
   static inline std::function<void(int fifo,
                                    stm32f3::can::CANMessage const& msg)>
       handle_rx_ = nullptr;
   static inline std::function<void()> handle_error_ = nullptr;
+  static inline std::function<void(stm32f3::can::CANMessage const& msg)>
+      handle_tx_complete_ = nullptr;
 };
 
 using AppCAN = stm32f3::can::BaremetalCAN<Handler>;
 inline void InitCAN() {
   stm32f3::GPIO<0, 11>::InitAsAF<9>();  // PA_11: CAN_RX (AF9)
   stm32f3::GPIO<0, 12>::InitAsAF<9>();  // PA_12: CAN_TX (AF9)
-  AppCAN::Init<CANMonitor::BaremetalRCC, (int)1e6>();
+  AppCAN::Init<CANMonitor::BaremetalRCC, schedule::kBitrate>();
 }
 
 }  // namespace CANMonitor
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+
+#include <f3/critical_section.hpp>
+#include <f3/peripherals/can.hpp>
+#include <f3/ram_vector.hpp>
+
+#include "rcc.hpp"
+#include "format_bench.hpp"
+#include "table_bench.hpp"
+#include "utils.hpp"
+
+namespace CANMonitor {
+//* CAN throughput benchmark
+//  Runs the controller in silent loopback mode (no transceiver or bus needed)
+//  and reports, per DLC, the sustained frame rate, the cycles spent in the RX
+//  and TX interrupts per frame and the latency from Send() to HandleRx.
+
+struct BenchResult {
+  unsigned int frames;
+  unsigned int errors;
+
+  unsigned int rx_isr_cycles;
+  unsigned int tx_isr_cycles;
+
+  unsigned int latency_sum;  // [cycles]
+  unsigned int latency_min;
+  unsigned int latency_max;
+  unsigned int latency_samples;
+};
+
+// Written by the CAN interrupts; copied under a CriticalSection
+static inline BenchResult bench_result;
+
+inline unsigned int BenchFramesReceived() {
+  return *static_cast<volatile unsigned int*>(&bench_result.frames);
+}
+
+struct BenchHandler {
+  static constexpr uint32_t kId = 0x123;
+
+  static void HandleRx(int, stm32f3::can::CANMessage const& msg) {
+    auto now = DWT->CYCCNT;
+    if (msg.id != kId) {
+      return;
+    }
+
+    bench_result.frames++;
+
+    // Frames with DLC >= 4 carry the DWT CYCCNT of their Send() call
+    if (msg.length < 4) {
+      return;
+    }
+    uint32_t sent = msg.data[0] | (msg.data[1] << 8) | (msg.data[2] << 16) |
+                    (msg.data[3] << 24);
+    unsigned int latency = now - sent;
+    bench_result.latency_sum += latency;
+    bench_result.latency_min = std::min(bench_result.latency_min, latency);
+    bench_result.latency_max = std::max(bench_result.latency_max, latency);
+    bench_result.latency_samples++;
+  }
+
+  static void HandleError() { bench_result.errors++; }
+};
+
+using BenchCAN = stm32f3::can::BaremetalCAN<BenchHandler>;
+
+class CANBench {
+  static constexpr int kBitrate = 1e6;
+  static constexpr unsigned int kCyclesPerUs =
+      BaremetalRCC::GetSystemClock() / 1000000;
+  static constexpr unsigned int kPassCycles =
+      BaremetalRCC::GetSystemClock() / 2;
+
+  /// @brief Nominal frame length with a standard ID, without stuff bits
+  static constexpr unsigned int FrameBits(unsigned int dlc) {
+    return 47 + 8 * dlc;
+  }
+
+  static void InitCycleCounter() {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  }
+
+  /// @brief Wrap the CAN interrupts installed by Init with cycle counting
+  static void InstrumentISRs() {
+    using stm32f3::ram_vector::ram_vector;
+
+    ram_vector[16 + CAN_RX0_IRQn] = []() {
+      auto start = DWT->CYCCNT;
+      BenchCAN::ISR_ProcessRxFIFO(0);
+      bench_result.rx_isr_cycles += DWT->CYCCNT - start;
+    };
+    ram_vector[16 + CAN_RX1_IRQn] = []() {
+      auto start = DWT->CYCCNT;
+      BenchCAN::ISR_ProcessRxFIFO(1);
+      bench_result.rx_isr_cycles += DWT->CYCCNT - start;
+    };
+    ram_vector[16 + CAN_TX_IRQn] = []() {
+      auto start = DWT->CYCCNT;
+      BenchCAN::ISR_ProcessTx();
+      bench_result.tx_isr_cycles += DWT->CYCCNT - start;
+    };
+  }
+
+  /// @brief Keep `in_flight` frames of `dlc` bytes outstanding for one pass
+  static BenchResult Run(unsigned int dlc, unsigned int in_flight) {
+    {
+      stm32f3::CriticalSection lock;
+      bench_result = {};
+      bench_result.latency_min = UINT32_MAX;
+    }
+
+    stm32f3::can::CANMessage msg{
+        .id = BenchHandler::kId, .length = dlc, .extended = false};
+    for (uint32_t i = 4; i < 8; i++) {
+      msg.data[i] = 0xA5;
+    }
+
+    unsigned int sent = 0;
+    auto start = DWT->CYCCNT;
+    while (DWT->CYCCNT - start < kPassCycles) {
+      if (sent - BenchFramesReceived() >= in_flight) {
+        continue;
+      }
+
+      uint32_t now = DWT->CYCCNT;
+      msg.data[0] = now;
+      msg.data[1] = now >> 8;
+      msg.data[2] = now >> 16;
+      msg.data[3] = now >> 24;
+      if (BenchCAN::Send(msg)) {
+        sent++;
+      }
+    }
+
+    // Let the frames still in the mailboxes arrive
+    auto drain = DWT->CYCCNT;
+    while (sent != BenchFramesReceived() &&
+           DWT->CYCCNT - drain < kPassCycles / 10)
+      ;
+
+    stm32f3::CriticalSection lock;
+    return bench_result;
+  }
+
+ public:
+  void Main() {
+    InitCycleCounter();
+    BenchCAN::Init<BaremetalRCC, kBitrate,
+                   stm32f3::can::CANMode::kSilentLoopback>();
+    InstrumentISRs();
+
+    printf("\x1b[2J\x1b[0;1H");
+    printf("F303K8 baremetal CAN benchmark (%d bit/s, silent loopback)"
+           NEWLINE, kBitrate);
+
+    TableBench().Main();
+    FormatBench().Main();
+
+    for (int round = 0;; round++) {
+      printf(NEWLINE "Round %d" NEWLINE, round);
+      printf("DLC  frames/s (nominal)  RX cyc/frm  TX cyc/frm  "
+             "latency min/avg/max [us]  errors" NEWLINE);
+
+      for (unsigned int dlc = 0; dlc <= 8; dlc++) {
+        // Saturated: one frame per TX mailbox
+        auto throughput = Run(dlc, 3);
+        // Unloaded: one frame at a time, so the latency excludes queueing
+        auto latency = Run(dlc, 1);
+
+        auto frames_per_s = throughput.frames * 2;  // kPassCycles = 0.5 s
+        unsigned int nominal = kBitrate / FrameBits(dlc);
+        auto frames = std::max<unsigned int>(throughput.frames, 1);
+        auto samples = std::max<unsigned int>(latency.latency_samples, 1);
+
+        printf("%3u  %8u (%6u)  %10u  %10u  ", dlc, frames_per_s,
+               nominal, throughput.rx_isr_cycles / frames,
+               throughput.tx_isr_cycles / frames);
+        if (latency.latency_samples == 0) {
+          printf("%24s", "-");
+        } else {
+          printf("%7u/%7u/%8u", latency.latency_min / kCyclesPerUs,
+                 latency.latency_sum / samples / kCyclesPerUs,
+                 latency.latency_max / kCyclesPerUs);
+        }
+        printf("  %6u" NEWLINE, throughput.errors + latency.errors);
+      }
+    }
+  }
+};
+}  // namespace CANMonitor
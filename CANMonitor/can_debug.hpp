@@ -1,91 +1,170 @@
 #pragma once
 
 #include <cstdint>
-#include <cstdio>
 
+#include <algorithm>
 #include <array>
 
-#include <Nano/fixed_map.hpp>
-
 #include "can.hpp"
+#include "can_id_table.hpp"
+#include "can_stats.hpp"
+#include "f3/critical_section.hpp"
+#include "f3/format.hpp"
 #include "f3/peripherals/can.hpp"
+#include "schedule.hpp"
+#include "screen.hpp"
 #include "tick_timer.hpp"
+#include "utils.hpp"
 
 class CanDebug {
-  const int kHeaderLines = 4;
+  static constexpr size_t kHeaderRows = 6;
 
-  struct CanMessageData {
-    static inline uint8_t last_line;
+  /// Time between two CANIdTable::Age calls
+  static constexpr uint32_t kStaleUs = 10000000;
 
-    bool is_invalidated = true;  ///! Status of the data
-    uint8_t line = last_line;    ///! [Visual] Line number on the screen
+  struct CanMessageData {
     std::array<std::uint8_t, 8> data = {};  ///! [Data] Content
-    uint8_t length = 0;                     ///! [Data] Length of the data
-    int rx_count = 0;                       ///! [Stat] Receive count
+    uint32_t rx_count = 0;                  ///! [Stat] Receive count
 
-    static void AddLine() { last_line++; }
+    // Every frame bumps rx_count, so it doubles as the seqlock generation
+    [[nodiscard]] uint32_t Generation() const { return rx_count; }
   };
 
-  void InitScreen() const {
-    printf("\x1b[2J\x1b[1;1H");
-    printf("\x1b[?25l");
-  }
+  /// Kept by slot in main SRAM, next to the timing statistics
+  struct FrameShape {
+    uint8_t length;  ///! [Data] Length of the data
+    uint8_t bits;    ///! [Stat] Last frame on wire
+  };
 
-  void UpdateScreen() {
-    for (auto&& pair : messages_) {
-      auto id = pair.key;
-      auto& data = pair.value;
+  // 256 IDs x (4 + 12) bytes fill the 4 KiB CCM RAM exactly; the timing
+  // statistics (16 bytes per ID) and frame shapes (2) are kept by slot in
+  // main SRAM
+  using MessageTable = CANMonitor::CANIdTable<CanMessageData, 256>;
+  static_assert(sizeof(MessageTable) <= 0x1000, "Does not fit CCM RAM");
 
-      if (!data->is_invalidated) {
-        continue;
-      }
+  static constexpr uint32_t kBitrate = CANMonitor::schedule::kBitrate;
+
+  // 6 header rows + 42 IDs (a taller table would not fit a terminal anyway)
+  using Screen = CANMonitor::Screen<48, 104>;
 
-      printf("\x1b[%d;1H", kHeaderLines + 1 + data->line);
-      printf("%8d] %08X (%5u):", tick_, id, data->rx_count);
-      for (size_t i = 0; i < data->length; i++) {
-        printf(" %02X", data->data[i]);
+  void UpdateScreen() {
+    // Rows follow the slot order, so a new ID moves the rows below it.
+    // Only the RX interrupt writes the table; rows are drawn from snapshots
+    // and compared with the generation drawn last time.
+    uint32_t layout = layout_generation_;
+    bool redraw = layout != drawn_layout_;
+    drawn_layout_ = layout;
+
+    size_t row = kHeaderRows;
+    messages_.ForEachSnapshot([&](size_t slot, uint32_t id, bool extended,
+                                  CanMessageData const& data) {
+      auto current = row++;
+      // The low 16 bits tell a change apart: far fewer frames arrive per
+      // screen frame
+      auto generation = static_cast<uint16_t>(data.rx_count);
+      if (generation == drawn_[slot] && !redraw && !screen_.Pending(current)) {
+        return;
+      }
+      drawn_[slot] = generation;
+
+      CANMonitor::CANIdStatistic timing;
+      FrameShape shape;
+      {
+        stm32f3::CriticalSection lock;  // Written by the RX interrupt
+        timing = timing_[slot];
+        shape = shapes_[slot];
       }
-      printf("\x1b[0K\n");
+      auto load = timing.LoadPermille(shape.bits, kBitrate);
+      auto length = std::min<size_t>(shape.length, data.data.size());
+      auto payload = FormatHEX(data.data.data(), length);
+      if (timing.HasPeriod()) {
+        screen_.Print<"{:8}] {:08X}{}({:5}) {:3} {:8} {:8} {:8} {:6} "
+                      "{:2}.{}%: {}">(
+            current, tick_, id, extended ? 'x' : ' ', data.rx_count, shape.bits,
+            timing.PeriodUs(), timing.MinUs(), timing.MaxUs(),
+            timing.JitterUs(), load / 10, load % 10, payload);
+      } else {
+        screen_.Print<"{:8}] {:08X}{}({:5}) {:3} {:>8} {:>8} {:>8} {:>6} "
+                      "{:>5}: {}">(current, tick_, id, extended ? 'x' : ' ',
+                                   data.rx_count, shape.bits, "-", "-", "-",
+                                   "-", "-", payload);
+      }
+    });
 
-      data->is_invalidated = false;
+    // Rows below the last ID (cleared after an eviction, kept blank)
+    for (; row < Screen::Rows(); row++) {
+      if (redraw || screen_.Pending(row)) {
+        screen_.Text(row, "", 0);
+      }
     }
   }
 
   void ShowHeader() {
-    printf("\x1b[1;1H");
-    printf("\x1b[2K");
-    printf("Tick: %5d\x1b[0K\n", tick_);
-    printf("Messages: %5u\x1b[0K\n", messages_count_);
-    printf("Last Failed: %5d\x1b[0K\n", last_failed_tick_);
+    auto size = messages_.Size();
+    auto shown = std::min<size_t>(size, Screen::Rows() - kHeaderRows);
+    auto screen = screen_.GetStatistic();
+
+    screen_.Print<"Tick: {:5}  Screen: {:3} ms/frame, {} B sent, {} deferred">(
+        0, tick_, screen_.PeriodMs(), screen.bytes, screen.deferred_frames);
+    screen_.Print<"Messages: {:5} (shown {}, evicted {}, dropped {})">(
+        1, size, shown, evicted_count_, dropped_count_);
+    screen_.Print<"Last Failed: {:5}">(2, last_failed_tick_);
+
+    auto window = bus_load_.Window(CANMonitor::MicroClock::Now());
+    auto load = bus_load_.LoadPermille(window, kBitrate);
+    screen_.Print<"Bus: {:2}.{}% of {} bit/s, {:5} frames/s (last {} ms)">(
+        3, load / 10, load % 10, kBitrate, bus_load_.FramesPerSecond(window),
+        BusLoad::kWindowUs / 1000);
+    screen_.Print<"{:>8}  {:<9}({:>5}) {:>3} {:>8} {:>8} {:>8} {:>6} {:>5}">(
+        4, "tick", "id", "count", "bit", "T[us]", "min[us]", "max[us]",
+        "J[us]", "load");
+    screen_.Text(kHeaderRows - 1, "", 0);  // Spacer above the table
   }
 
   void Init() {
-    InitScreen();
+    stm32f3::Print<"CAN Monitor App (" __TIME__ ")\nInitializing...\n">();
 
-    printf("CAN Monitor App (%s)\n", __TIME__);
-    printf("Initializing...\n");
-    fflush(stdout);
-
-    InitScreen();
+    screen_.Clear();
   }
 
  public:
   CanDebug() {
+    messages_.Clear();  // .ccmbss is not zero-filled by the startup code
+    CANMonitor::MicroClock::Init();
+
     auto rx = ([this](int fifo, stm32f3::can::CANMessage const& msg) {
-      auto const& id = msg.id;
-      auto const& data = msg.data;
+      auto now = CANMonitor::MicroClock::Now();
+      auto bits = CANMonitor::FrameBits(msg);
+      bus_load_.Add(now, bits);
+
+      auto [entry, result] = messages_.FindOrInsert(msg.id, msg.extended);
+      if (result == CANMonitor::CANIdInsert::kFull) {
+        dropped_count_++;
+        last_failed_tick_ = tick_;
+        return;
+      }
 
-      if (!messages_.Contains(id)) {
-        messages_[id] = CanMessageData();
-        messages_count_++;
-        CanMessageData::AddLine();
+      auto slot = messages_.SlotOf(entry);
+      auto& timing = timing_[slot];
+      switch (result) {
+        case CANMonitor::CANIdInsert::kEvicted:
+          evicted_count_++;
+          [[fallthrough]];
+        case CANMonitor::CANIdInsert::kInserted:
+          layout_generation_ = layout_generation_ + 1;
+          timing = {};
+          break;
+        default:
+          break;
       }
 
-      auto&& msg_stat = messages_[id];
-      msg_stat.is_invalidated = true;
+      auto& msg_stat = *entry;
+      timing.Arrive(now, result != CANMonitor::CANIdInsert::kFound);
+      shapes_[slot] = {
+          .length = static_cast<uint8_t>(msg.remote ? 0 : msg.length),
+          .bits = static_cast<uint8_t>(bits)};
       msg_stat.rx_count++;
-      msg_stat.length = static_cast<uint8_t>(data.size());
-      msg_stat.data = data;
+      msg_stat.data = msg.data;
     });
     auto err = [] {
     };
@@ -96,18 +175,38 @@ class CanDebug {
   [[noreturn]] void Main() {
     Init();
 
+    uint32_t aged_us = CANMonitor::MicroClock::Now();
     while (true) {
-      UpdateScreen();
+      screen_.BeginFrame();
       ShowHeader();
+      UpdateScreen();
+      auto idle_ms = screen_.EndFrame();
       tick_++;
 
-      WaitMS(10);
+      auto now = CANMonitor::MicroClock::Now();
+      if (now - aged_us >= kStaleUs) {
+        messages_.Age();
+        aged_us = now;
+      }
+
+      WaitMS(idle_ms);
     }
   }
 
  private:
-  Nano::collection::FixedMap<uint32_t, CanMessageData, 32> messages_;
-  uint32_t messages_count_ = 0;
+  using BusLoad = CANMonitor::CANBusLoad<>;
+
+  static inline MessageTable messages_ __attribute__((section(".ccmbss")));
+  static inline std::array<CANMonitor::CANIdStatistic, MessageTable::Capacity()>
+      timing_;
+  static inline std::array<FrameShape, MessageTable::Capacity()> shapes_;
+  static inline BusLoad bus_load_;
+  static inline std::array<uint16_t, MessageTable::Capacity()> drawn_ = {};
+  static inline Screen screen_;
+  volatile uint32_t layout_generation_ = 0;  // Written by the RX interrupt
+  uint32_t drawn_layout_ = UINT32_MAX;
+  unsigned int evicted_count_ = 0;
+  unsigned int dropped_count_ = 0;
   int tick_ = 0;
   int last_failed_tick_ = 0;
 };
\ No newline at end of file
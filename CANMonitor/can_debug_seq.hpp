@@ -1,13 +1,22 @@
 #include <f3/eventlog.hpp>
 #include "f3/peripherals/can.hpp"
+#include "f3/peripherals/can_scheduler.hpp"
 
 #include "can.hpp"
 #include "event_log.hpp"
+#include "schedule.hpp"
+#include "screen.hpp"
 #include "tick_timer.hpp"
 #include "utils.hpp"
 
 namespace CANMonitor {
 class CANDebug_Seq {
+  using Schedule =
+      stm32f3::can::CANScheduler<AppCAN, schedule::kHeartbeat,
+                                 schedule::kStatus, schedule::kTelemetry>;
+  using Screen = CANMonitor::Screen<32, 104>;
+
+  static inline Screen screen_;
 
  public:
   CANDebug_Seq() {}
@@ -21,58 +30,98 @@ class CANDebug_Seq {
     };
     InitTimer<Handler>();
 
-    printf("\x1b[2J");  // Clear Screen
-    kEventLog.Log("CAN Initialized");
+    screen_.Clear();
+    kEventLog.Log<"CAN Initialized">();
 
     auto rx = [](int _, stm32f3::can::CANMessage const& msg) {
-      auto str = FormatHEX(msg.data.data(), msg.data.size());
-      kEventLog.Log("CAN Rx: %08X [%s]", msg.id, str);
+      // The payload is stored, not formatted: big-endian words print the
+      // bytes in wire order
+      uint32_t high, low;
+      memcpy(&high, &msg.data[0], sizeof(high));
+      memcpy(&low, &msg.data[4], sizeof(low));
+      kEventLog.Log<"CAN Rx: {:08X} [{:08X}{:08X}]">(
+          msg.id, __builtin_bswap32(high), __builtin_bswap32(low));
     };
     auto err = [] {
     };
     CANMonitor::Handler::Init(rx, err);
+    CANMonitor::Handler::InitTxComplete(Schedule::OnTxComplete);
+
+    Schedule::Update<0>({0x55, 0x55, 0x55, 0x55, 0x55});
+    Schedule::Start<BaremetalRCC, schedule::kBitrate>();
 
     LED::InitAsGPIO();
 
     int i = 0;
     while (true) {
       //* UI
-      printf("\x1b[0;1H");
+      screen_.BeginFrame();
+      size_t row = 0;
 
-      printf("F303K8 baremetal CAN Test (loop=%d)" NEWLINE, i);
+      screen_.Print<"F303K8 baremetal CAN Test (loop={})">(row++, i);
 
       auto error_statistic = AppCAN::GetErrorStatistic();
-      printf("CAN Status [%s]" NEWLINE, error_statistic.StatusToString());
-      printf("  - REC: %d, TEC: %d" NEWLINE, error_statistic.rec,
-             error_statistic.tec);
-      printf("  - LEC: %s" NEWLINE, error_statistic.LastErrorCodeToString());
-
-      printf("CAN Tx Status" NEWLINE);
+      screen_.Print<"CAN Status [{}]">(row++,
+                                       error_statistic.StatusToString());
+      screen_.Print<"  - REC: {}, TEC: {}">(row++, error_statistic.rec,
+                                            error_statistic.tec);
+      screen_.Print<"  - LEC: {}">(row++,
+                                   error_statistic.LastErrorCodeToString());
+      screen_.Print<"  - RX Full/Overrun: FIFO0 {}/{}, FIFO1 {}/{}">(
+          row++, error_statistic.fifo_full[0], error_statistic.fifo_overrun[0],
+          error_statistic.fifo_full[1], error_statistic.fifo_overrun[1]);
+      screen_.Print<"  - Warning/Passive/Bus-off: {}/{}/{}">(
+          row++, error_statistic.warning_events,
+          error_statistic.passive_events, error_statistic.bus_off_events);
+      screen_.Print<"  - Stuff/Form/Ack/Bit1/Bit0/CRC: {}/{}/{}/{}/{}/{}">(
+          row++, error_statistic.lec_events[1], error_statistic.lec_events[2],
+          error_statistic.lec_events[3], error_statistic.lec_events[4],
+          error_statistic.lec_events[5], error_statistic.lec_events[6]);
+
+      screen_.Print<"CAN Tx Status">(row++);
       auto mailbox0 = AppCAN::GetTxMailbox<0>();
-      printf("  - MailBox0 [%s]: %s" NEWLINE, mailbox0.StatusToString(),
-             FormatHEX(mailbox0.GetData().data(), mailbox0.GetDLC()));
+      screen_.Print<"  - MailBox0 [{}]: {}">(
+          row++, mailbox0.StatusToString(),
+          FormatHEX(mailbox0.GetData().data(), mailbox0.GetDLC()));
       auto mailbox1 = AppCAN::GetTxMailbox<1>();
-      printf("  - MailBox1 [%s]: %s" NEWLINE, mailbox1.StatusToString(),
-             FormatHEX(mailbox1.GetData().data(), mailbox1.GetDLC()));
+      screen_.Print<"  - MailBox1 [{}]: {}">(
+          row++, mailbox1.StatusToString(),
+          FormatHEX(mailbox1.GetData().data(), mailbox1.GetDLC()));
       auto mailbox2 = AppCAN::GetTxMailbox<2>();
-      printf("  - MailBox2 [%s]: %s" NEWLINE, mailbox2.StatusToString(),
-             FormatHEX(mailbox2.GetData().data(), mailbox2.GetDLC()));
+      screen_.Print<"  - MailBox2 [{}]: {}">(
+          row++, mailbox2.StatusToString(),
+          FormatHEX(mailbox2.GetData().data(), mailbox2.GetDLC()));
+
+      screen_.Print<"Schedule">(row++);
+      for (size_t e = 0; e < Schedule::kTable.size(); e++) {
+        auto statistic = Schedule::GetStatistic(e);
+        auto samples = statistic.jitter_samples ? statistic.jitter_samples : 1;
+        screen_.Print<"  - {:03X} @{}ms+{}: sent {}/{}, overrun {}, "
+                      "dropped {}, jitter {}..{} (avg |{}|) us">(
+            row++, Schedule::kTable[e].id, Schedule::kTable[e].period_ms,
+            Schedule::kOffsets[e], statistic.sent, statistic.released,
+            statistic.overruns, statistic.dropped,
+            statistic.jitter_samples ? statistic.jitter_min_us : 0,
+            statistic.jitter_samples ? statistic.jitter_max_us : 0,
+            statistic.jitter_abs_sum_us / samples);
+      }
 
-      printf("Events\n");
-      for (auto log : kEventLog) {
-        printf("  - %d: %s" NEWLINE, log->timestamp, log->message);
+      screen_.Print<"Events">(row++);
+      kEventLog.ForEach(
+          [&](uint32_t timestamp, char const* message) {
+            screen_.Print<"  - {}: {}">(row++, timestamp, message);
+          },
+          Screen::Rows() - row);
+      while (row < Screen::Rows()) {
+        screen_.Text(row++, "", 0);
       }
+      auto idle_ms = screen_.EndFrame();
 
       //* Blink PB_3
       LED::ToggleGPIO();
 
-      if (i % 100) {
-        AppCAN::Send(
-            {.id = 0x555, .length = 5, .data = {0x55, 0x55, 0x55, 0x55, 0x55}});
-      }
-
       i++;
-      WaitMS(10);
+      WaitMS(idle_ms);
     }
   }
 };
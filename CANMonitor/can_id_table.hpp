@@ -0,0 +1,218 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <f3/critical_section.hpp>
+
+namespace CANMonitor {
+enum class CANIdInsert {
+  kFound,     // Already in the table
+  kInserted,  // Took an empty slot
+  kEvicted,   // Replaced a stale identifier
+  kFull,      // Probe window is full of recently seen identifiers
+};
+
+/// @brief A Value whose writer changes Generation() on every update
+template <typename T>
+concept CANIdVersionedLike = requires(T const& value) {
+  { value.Generation() } -> std::convertible_to<uint32_t>;
+};
+
+/// @brief Fixed-capacity open-addressing map from CAN identifier to Value
+/// @details Linear probing over at most kMaxProbe slots from the home slot.
+///          Slots are never emptied again, so a lookup stops at the first
+///          empty slot. Once a probe window is full, a new identifier replaces
+///          one that has not been seen since the last Age() (CLOCK policy).
+///          The table is just two arrays, so it can be placed in CCM RAM
+///          (call Clear() before use if the section is not zero-filled).
+template <typename Value, size_t kCapacity, size_t kMaxProbe = 8>
+class CANIdTable {
+  static_assert(std::has_single_bit(kCapacity), "Capacity must be 2^n");
+  static_assert(0 < kMaxProbe && kMaxProbe <= kCapacity);
+
+  static constexpr uint32_t kEmpty = 0xFFFFFFFF;
+  static constexpr uint32_t kExtended = 1u << 31;
+  static constexpr uint32_t kReferenced = 1u << 30;  // Seen since Age()
+  static constexpr uint32_t kIdMask = 0x1FFFFFFF;
+  static constexpr int kShift = 32 - std::countr_zero(kCapacity);
+
+  std::array<uint32_t, kCapacity> keys_;  // kExtended | ID, or kEmpty
+  std::array<Value, kCapacity> values_;
+
+  static constexpr uint32_t Key(uint32_t id, bool extended) {
+    return (id & kIdMask) | (extended ? kExtended : 0);
+  }
+
+  static constexpr size_t Home(uint32_t key) {
+    if constexpr (kCapacity == 1) {
+      return 0;
+    } else {
+      return (key * 0x9E3779B1u) >> kShift;  // Fibonacci hashing
+    }
+  }
+
+  static constexpr size_t Next(size_t slot) {
+    return (slot + 1) & (kCapacity - 1);
+  }
+
+  /// Retries before ForEachSnapshot copies a slot with interrupts masked
+  static constexpr int kMaxSnapshotRetries = 4;
+
+  /// Key without the kReferenced bit (Age may clear it meanwhile)
+  uint32_t LoadKey(size_t slot) const {
+    auto key = *static_cast<uint32_t const volatile*>(&keys_[slot]);
+    return key == kEmpty ? kEmpty : key & ~kReferenced;
+  }
+
+  /// Generation of the live value (re-read on every call)
+  uint32_t LoadGeneration(size_t slot) const {
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    auto generation = values_[slot].Generation();
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    return generation;
+  }
+
+ public:
+  CANIdTable() { Clear(); }
+
+  void Clear() {
+    keys_.fill(kEmpty);
+    values_.fill(Value{});
+  }
+
+  [[nodiscard]] static constexpr size_t Capacity() { return kCapacity; }
+
+  /// @brief Slot of a Value returned by Find / FindOrInsert, e.g. to index
+  ///        per-slot data kept outside the table
+  [[nodiscard]] size_t SlotOf(Value const* value) const {
+    return value - values_.data();
+  }
+
+  /// @return nullptr if the identifier is not in the table
+  Value* Find(uint32_t id, bool extended) {
+    auto key = Key(id, extended);
+    auto slot = Home(key);
+    for (size_t n = 0; n < kMaxProbe; n++, slot = Next(slot)) {
+      auto stored = keys_[slot];
+      if (stored == kEmpty) {
+        return nullptr;
+      }
+      if ((stored & ~kReferenced) == key) {
+        keys_[slot] = stored | kReferenced;
+        return &values_[slot];
+      }
+    }
+    return nullptr;
+  }
+
+  /// @brief Look up an identifier, adding it with a default Value if needed
+  /// @return {nullptr, kFull} if it could not be added
+  std::pair<Value*, CANIdInsert> FindOrInsert(uint32_t id, bool extended) {
+    auto key = Key(id, extended);
+    auto slot = Home(key);
+    size_t victim = kCapacity;
+
+    for (size_t n = 0; n < kMaxProbe; n++, slot = Next(slot)) {
+      auto stored = keys_[slot];
+      if (stored == kEmpty) {
+        keys_[slot] = key | kReferenced;
+        values_[slot] = Value{};
+        return {&values_[slot], CANIdInsert::kInserted};
+      }
+      if ((stored & ~kReferenced) == key) {
+        keys_[slot] = stored | kReferenced;
+        return {&values_[slot], CANIdInsert::kFound};
+      }
+      if (victim == kCapacity && (stored & kReferenced) == 0) {
+        victim = slot;
+      }
+    }
+
+    if (victim == kCapacity) {
+      return {nullptr, CANIdInsert::kFull};
+    }
+    keys_[victim] = key | kReferenced;
+    values_[victim] = Value{};
+    return {&values_[victim], CANIdInsert::kEvicted};
+  }
+
+  /// @brief Start a new stale period: identifiers that are not seen again
+  ///        before the next call may be evicted
+  /// @note Safe against FindOrInsert running in an interrupt
+  void Age() {
+    for (auto& key : keys_) {
+      stm32f3::CriticalSection lock;
+      if (key != kEmpty) {
+        key &= ~kReferenced;
+      }
+    }
+  }
+
+  [[nodiscard]] size_t Size() const {
+    size_t size = 0;
+    for (auto key : keys_) {
+      size += key != kEmpty;
+    }
+    return size;
+  }
+
+  /// @brief Visit consistent copies of the entries in slot order:
+  ///        fn(slot, id, extended, Value const&)
+  /// @details For a reader that the (single) writer can interrupt, such as
+  ///          the main loop against a CAN RX interrupt. Each slot is a
+  ///          seqlock: the key and Value::Generation() are read before the
+  ///          copy and compared with the live ones after it, and the copy is
+  ///          retried if either changed, or made with interrupts masked after
+  ///          kMaxSnapshotRetries. An update runs to completion once it
+  ///          interrupts the reader, so the writer only has to change the
+  ///          generation in every update, in any order with the other fields.
+  template <typename Fn>
+    requires CANIdVersionedLike<Value>
+  void ForEachSnapshot(Fn&& fn) const {
+    for (size_t slot = 0; slot < kCapacity; slot++) {
+      uint32_t key;
+      Value value;
+
+      int retry = 0;
+      for (;; retry++) {
+        if (retry == kMaxSnapshotRetries) {
+          stm32f3::CriticalSection lock;
+          key = LoadKey(slot);
+          value = values_[slot];
+          break;
+        }
+
+        key = LoadKey(slot);
+        auto generation = LoadGeneration(slot);
+        value = values_[slot];
+        if (LoadGeneration(slot) == generation && LoadKey(slot) == key) {
+          break;
+        }
+      }
+
+      if (key == kEmpty) {
+        continue;
+      }
+      fn(slot, key & kIdMask, (key & kExtended) != 0, value);
+    }
+  }
+
+  /// @brief Visit entries in slot order: fn(id, extended, Value&)
+  template <typename Fn>
+  void ForEach(Fn&& fn) {
+    for (size_t slot = 0; slot < kCapacity; slot++) {
+      auto key = keys_[slot];
+      if (key == kEmpty) {
+        continue;
+      }
+      fn(key & kIdMask, (key & kExtended) != 0, values_[slot]);
+    }
+  }
+};
+}  // namespace CANMonitor
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <f3/critical_section.hpp>
+#include <f3/peripherals/can.hpp>
+#include <f3/peripherals/can_analysis.hpp>
+
+#include "rcc.hpp"
+
+namespace CANMonitor {
+//* Bus statistics
+//  Per-ID timing and bus load computed from the received frames, O(1) per
+//  frame in 32-bit fixed point. Only frames accepted by the filters are seen,
+//  so error frames and filtered traffic are not part of the load.
+
+/// @brief Microseconds since Init, extended from the DWT cycle counter
+/// @note  Now() must run at least once per CYCCNT wrap (107 s at 40 MHz)
+class MicroClock {
+  static constexpr uint32_t kCyclesPerUs =
+      BaremetalRCC::GetSystemClock() / 1000000;
+  static_assert(kCyclesPerUs > 0);
+
+ public:
+  static void Init() {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    last_cycles_ = DWT->CYCCNT;
+  }
+
+  static uint32_t Now() {
+    stm32f3::CriticalSection lock;
+    auto cycles = DWT->CYCCNT;
+    auto elapsed = cycles - last_cycles_ + remainder_;
+    last_cycles_ = cycles;
+    now_us_ += elapsed / kCyclesPerUs;
+    remainder_ = elapsed % kCyclesPerUs;
+    return now_us_;
+  }
+
+ private:
+  static inline uint32_t last_cycles_ = 0;
+  static inline uint32_t remainder_ = 0;
+  static inline uint32_t now_us_ = 0;
+};
+
+/// @brief Monotonic 16-bit encoding of an interval below 2^27 us
+/// @details 4-bit exponent, 12-bit mantissa: exact below 4096 us, within
+///          0.05 % above. Codes compare like the intervals they encode.
+namespace compact_us {
+static constexpr uint32_t kMax = (1u << 27) - 1;
+
+constexpr uint16_t Encode(uint32_t us) {
+  us = std::min(us, kMax);
+  uint32_t exponent = 0;
+  while (us >= 4096) {
+    us >>= 1;
+    exponent++;
+  }
+  // Exponent 0 is denormal (0 .. 4095), others are 2048 .. 4095 << exponent
+  return exponent == 0 ? us : (exponent << 11 | (us - 2048)) + 2048;
+}
+
+constexpr uint32_t Decode(uint16_t code) {
+  if (code < 4096) {
+    return code;
+  }
+  uint32_t exponent = (code - 2048) >> 11;
+  return (((code - 2048) & 0x7FF) + 2048) << exponent;
+}
+}  // namespace compact_us
+
+/// @brief Inter-arrival statistics of one identifier (16 bytes)
+/// @details The mean period and the jitter (mean absolute deviation from the
+///          mean period, as RFC 3550 does it) are exponential moving averages
+///          over ~16 frames, kept in 1/16 us. Min/max use compact_us.
+struct CANIdStatistic {
+  static constexpr int kFractionBits = 4;
+  static constexpr int kWeightBits = 4;  // alpha = 1/16
+  static constexpr uint32_t kMaxIntervalUs = compact_us::kMax;  // q4 fits
+
+  uint32_t last_us = 0;
+  uint32_t period_q4 = 0;
+  uint32_t jitter_q4 = 0;
+  uint16_t min_code = UINT16_MAX;
+  uint16_t max_code = 0;
+
+  /// @param first First frame of this identifier
+  void Arrive(uint32_t now_us, bool first) {
+    auto interval = now_us - last_us;
+    last_us = now_us;
+    if (first) {
+      return;
+    }
+
+    interval = std::min(interval, kMaxIntervalUs);
+    auto code = compact_us::Encode(interval);
+    min_code = std::min(min_code, code);
+    max_code = std::max(max_code, code);
+
+    auto sample = static_cast<int32_t>(interval << kFractionBits);
+    if (period_q4 == 0) {
+      period_q4 = sample;
+      return;
+    }
+    auto error = sample - static_cast<int32_t>(period_q4);
+    period_q4 += error >> kWeightBits;
+
+    auto deviation = error < 0 ? -error : error;
+    jitter_q4 += (deviation - static_cast<int32_t>(jitter_q4)) >> kWeightBits;
+  }
+
+  [[nodiscard]] bool HasPeriod() const { return period_q4 != 0; }
+  [[nodiscard]] uint32_t PeriodUs() const { return period_q4 >> kFractionBits; }
+  [[nodiscard]] uint32_t JitterUs() const { return jitter_q4 >> kFractionBits; }
+  [[nodiscard]] uint32_t MinUs() const { return compact_us::Decode(min_code); }
+  [[nodiscard]] uint32_t MaxUs() const { return compact_us::Decode(max_code); }
+
+  /// @brief Share of the bus taken by this identifier [1e-3]
+  [[nodiscard]] uint32_t LoadPermille(uint32_t frame_bits,
+                                      uint32_t bitrate) const {
+    if (!HasPeriod()) {
+      return 0;
+    }
+    // bits * 1e6 / period [bit/s], scaled by 1000 / bitrate
+    auto bits_per_s =
+        frame_bits * (1000000u << kFractionBits) / period_q4;
+    return static_cast<uint64_t>(bits_per_s) * 1000 / bitrate;
+  }
+};
+
+/// @brief Bus load over a sliding window of kBuckets x kBucketUs
+/// @details Each frame adds its bits to the current bucket. Moving to a new
+///          bucket subtracts the oldest one from the running sums, so both
+///          Add and Load are O(kBuckets) at worst after a long idle gap and
+///          O(1) otherwise. The window excludes the bucket being filled.
+template <size_t kBuckets = 10, uint32_t kBucketUs = 100000>
+class CANBusLoad {
+  static_assert(kBuckets >= 2);
+
+  struct Bucket {
+    uint32_t bits;
+    uint32_t frames;
+  };
+
+  std::array<Bucket, kBuckets> buckets_ = {};
+  size_t current_ = 0;
+  uint32_t bucket_start_us_ = 0;
+  Bucket window_ = {};  // Sum of every bucket but the current one
+
+  void Advance(uint32_t now_us) {
+    for (size_t n = 0; now_us - bucket_start_us_ >= kBucketUs; n++) {
+      if (n == kBuckets) {  // Idle for a whole window
+        buckets_ = {};
+        window_ = {};
+        bucket_start_us_ = now_us - (now_us - bucket_start_us_) % kBucketUs;
+        return;
+      }
+
+      window_.bits += buckets_[current_].bits;
+      window_.frames += buckets_[current_].frames;
+      current_ = (current_ + 1) % kBuckets;
+      window_.bits -= buckets_[current_].bits;
+      window_.frames -= buckets_[current_].frames;
+      buckets_[current_] = {};
+      bucket_start_us_ += kBucketUs;
+    }
+  }
+
+ public:
+  static constexpr uint32_t kWindowUs = (kBuckets - 1) * kBucketUs;
+
+  void Add(uint32_t now_us, uint32_t bits) {
+    stm32f3::CriticalSection lock;
+    Advance(now_us);
+    buckets_[current_].bits += bits;
+    buckets_[current_].frames++;
+  }
+
+  /// @brief Bits and frames seen during the last kWindowUs
+  Bucket Window(uint32_t now_us) {
+    stm32f3::CriticalSection lock;
+    Advance(now_us);
+    return window_;
+  }
+
+  /// @return Bus utilization [1e-3]
+  static uint32_t LoadPermille(Bucket const& window, uint32_t bitrate) {
+    return static_cast<uint64_t>(window.bits) * 1000000000 /
+           (static_cast<uint64_t>(bitrate) * kWindowUs);
+  }
+
+  static uint32_t FramesPerSecond(Bucket const& window) {
+    return static_cast<uint64_t>(window.frames) * 1000000 / kWindowUs;
+  }
+};
+
+/// @brief On-wire bits of a received frame, stuff bits included
+inline uint32_t FrameBits(stm32f3::can::CANMessage const& msg) {
+  return stm32f3::can::CANFrameBits(msg.id, msg.extended, msg.remote,
+                                    msg.length, msg.data.data());
+}
+}  // namespace CANMonitor
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <f3/console.hpp>
+#include <f3/peripherals/can.hpp>
+#include <f3/peripherals/crc16.hpp>
+
+#include "can.hpp"
+#include "can_stats.hpp"
+#include "capture_protocol.hpp"
+
+namespace CANMonitor {
+/// Console speed of the capture stream (see capture_protocol.hpp)
+static constexpr uint32_t kCaptureBaudrate = 2500000;
+
+//* Binary capture
+//  Streams every received frame as a COBS-framed record with a microsecond
+//  timestamp, about a third of the bytes of the text views. Decode with:
+//    stty -F /dev/ttyACM0 raw 2500000
+//    can_capture /dev/ttyACM0 > bus.log         # candump -l format
+//    can_capture --pcap bus.pcap /dev/ttyACM0   # Wireshark
+//  The RX interrupt only copies frames into a ring; the main loop encodes
+//  them and writes the console back to back.
+
+template <stm32f3::ConsoleConfig Config>
+class Capture {
+  using Console = stm32f3::Console<Config>;
+  using Checksum = stm32f3::CRC16<capture::kCrcPolynomial, capture::kCrcInit>;
+
+  static void HandleRx(int, stm32f3::can::CANMessage const& msg) {
+    rx_ring_.Push({
+        .time_us = MicroClock::Now(),
+        .id = msg.id,
+        .length = static_cast<uint8_t>(std::min<uint32_t>(msg.length, 8)),
+        .extended = msg.extended,
+        .remote = msg.remote,
+        .data = msg.data,
+    });
+  }
+
+  static uint32_t Overruns() {
+    auto errors = AppCAN::GetErrorStatistic();
+    return errors.fifo_overrun[0] + errors.fifo_overrun[1];
+  }
+
+  /// @brief Append the CRC, COBS-encode and write one record
+  static void Emit(uint8_t* record, size_t length) {
+    auto crc = Checksum{}.Update(record, length).Value();
+    length = capture::Put(record + length, crc, 2) - record;
+
+    std::array<uint8_t, capture::kMaxEncoded> encoded;
+    auto size = capture::CobsEncode(record, length, encoded.data());
+    for (size_t i = 0; i < size; i++) {
+      Console::UART::WriteBuffered(encoded[i]);
+    }
+  }
+
+  void EmitSync(uint32_t now_us) {
+    std::array<uint8_t, capture::kMaxRecord> record;
+    auto length = capture::EncodeSync(
+        {.time_us = now_us,
+         .frames = frames_,
+         .dropped = rx_ring_.Overflow(),
+         .overruns = Overruns()},
+        record.data());
+    Emit(record.data(), length);
+    last_us_ = now_us;
+    last_sync_us_ = now_us;
+  }
+
+ public:
+  Capture() {
+    MicroClock::Init();
+    Handler::Init(HandleRx, [] {});
+  }
+
+  [[noreturn]] void Main() {
+    EmitSync(MicroClock::Now());
+
+    while (true) {
+      capture::Frame frame;
+      if (!rx_ring_.Pop(frame)) {
+        auto now = MicroClock::Now();
+        if (now - last_sync_us_ >= capture::kSyncIntervalUs) {
+          EmitSync(now);
+        }
+        continue;
+      }
+
+      // Frames must unwrap against the previous record; the ISR may have
+      // stamped this one just before an idle Sync, hence the signed check
+      auto gap = static_cast<int32_t>(frame.time_us - last_us_);
+      if (gap < 0 || gap > static_cast<int32_t>(capture::kMaxGapUs) ||
+          frame.time_us - last_sync_us_ >= capture::kSyncIntervalUs) {
+        EmitSync(frame.time_us);
+      }
+
+      std::array<uint8_t, capture::kMaxRecord> record;
+      auto length = capture::EncodeFrame(frame, record.data());
+      Emit(record.data(), length);
+      last_us_ = frame.time_us;
+      frames_++;
+    }
+  }
+
+ private:
+  static constexpr size_t kRxRingDepth = 64;
+
+  static inline stm32f3::can::CANRxRing<kRxRingDepth, capture::Frame>
+      rx_ring_;
+
+  uint32_t frames_ = 0;  // Frame records sent
+  uint32_t last_us_ = 0;
+  uint32_t last_sync_us_ = 0;
+};
+}  // namespace CANMonitor
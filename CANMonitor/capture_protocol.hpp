@@ -0,0 +1,210 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+//* Binary capture stream
+//  Records are COBS-encoded and terminated by 0x00, so a receiver that
+//  starts mid-stream or drops a byte resynchronizes at the next record.
+//  Only depends on the standard library; tools/can_capture decodes it.
+//
+//  Record (little endian), followed by a CRC-16/CCITT-FALSE of its bytes:
+//    Frame  [header][time_us & 0xFFFF : 2][id : 2 (std) or 4 (ext)][data]
+//    Sync   [header][time_us : 4][frames : 4][dropped : 4][overruns : 4]
+//  header = type << 6 | extended << 5 | remote << 4 | length
+//
+//  Frame times are the low 16 bits of the microsecond clock: the receiver
+//  unwraps them against the previous record, and the sender puts a Sync
+//  (absolute time) in front of any gap longer than kMaxGapUs. Syncs also
+//  go out every kSyncIntervalUs with the device's frame and loss counters.
+//  `frames` counts the Frame records sent before the Sync, so the receiver
+//  finds what the line lost by comparing it with the ones it decoded.
+//
+//  Longest frame record: 1 + 2 + 4 + 8 + 2 = 17 bytes, 19 on the wire. At
+//  2.5 Mbaud that is 76 us against 131 us for the frame on a 1 Mbit/s bus
+//  (DLC 0: 36 us against 47 us), so a saturated bus is captured losslessly.
+
+namespace CANMonitor::capture {
+static constexpr uint16_t kCrcPolynomial = 0x1021;
+static constexpr uint16_t kCrcInit = 0xFFFF;
+
+static constexpr uint32_t kMaxGapUs = 0xFFFF;
+static constexpr uint32_t kSyncIntervalUs = 1000000;
+
+static constexpr size_t kMaxRecord = 19;  // Sync, CRC included
+/// COBS overhead of a record (< 254 bytes) and the delimiter
+static constexpr size_t kMaxEncoded = kMaxRecord + 2;
+
+enum RecordType : uint8_t {
+  kFrameRecord = 0,
+  kSyncRecord = 1,
+};
+
+static constexpr int kTypeShift = 6;
+static constexpr uint8_t kExtendedBit = 1 << 5;
+static constexpr uint8_t kRemoteBit = 1 << 4;
+static constexpr uint8_t kLengthMask = 0x0F;
+
+struct Frame {
+  uint32_t time_us;
+  uint32_t id;
+  uint8_t length;
+  bool extended;
+  bool remote;
+  std::array<uint8_t, 8> data;
+};
+
+struct Sync {
+  uint32_t time_us;
+  uint32_t frames;    // Frame records sent by the device
+  uint32_t dropped;   // Received, lost to a full ring in the device
+  uint32_t overruns;  // Never received: CAN RX FIFO overruns
+};
+
+/// @brief Software CRC-16/CCITT-FALSE, as computed by stm32f3::CRC16
+constexpr uint16_t Crc16(uint8_t const* data, size_t length,
+                         uint16_t crc = kCrcInit) {
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i] << 8;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = crc & 0x8000 ? (crc << 1) ^ kCrcPolynomial : crc << 1;
+    }
+  }
+  return crc;
+}
+
+constexpr uint8_t* Put(uint8_t* out, uint32_t value, int bytes) {
+  for (int i = 0; i < bytes; i++) {
+    *out++ = value >> (8 * i);
+  }
+  return out;
+}
+
+constexpr uint32_t Get(uint8_t const* in, int bytes) {
+  uint32_t value = 0;
+  for (int i = 0; i < bytes; i++) {
+    value |= static_cast<uint32_t>(in[i]) << (8 * i);
+  }
+  return value;
+}
+
+/// @brief Serialize a frame record without its CRC
+/// @return Length of the record
+constexpr size_t EncodeFrame(Frame const& frame, uint8_t* out) {
+  auto begin = out;
+  size_t length = frame.length > 8 ? 8 : frame.length;
+  *out++ = kFrameRecord << kTypeShift | (frame.extended ? kExtendedBit : 0) |
+           (frame.remote ? kRemoteBit : 0) | length;
+  out = Put(out, frame.time_us, 2);
+  out = Put(out, frame.id, frame.extended ? 4 : 2);
+  if (!frame.remote) {
+    for (size_t i = 0; i < length; i++) {
+      *out++ = frame.data[i];
+    }
+  }
+  return out - begin;
+}
+
+/// @brief Serialize a sync record without its CRC
+constexpr size_t EncodeSync(Sync const& sync, uint8_t* out) {
+  auto begin = out;
+  *out++ = kSyncRecord << kTypeShift;
+  out = Put(out, sync.time_us, 4);
+  out = Put(out, sync.frames, 4);
+  out = Put(out, sync.dropped, 4);
+  out = Put(out, sync.overruns, 4);
+  return out - begin;
+}
+
+/// @brief COBS-encode `length` (< 254) bytes and append the 0x00 delimiter
+/// @return Bytes written, at most length + 2
+constexpr size_t CobsEncode(uint8_t const* in, size_t length, uint8_t* out) {
+  size_t code_at = 0;
+  size_t size = 1;
+  uint8_t code = 1;
+  for (size_t i = 0; i < length; i++) {
+    if (in[i] == 0) {
+      out[code_at] = code;
+      code_at = size++;
+      code = 1;
+    } else {
+      out[size++] = in[i];
+      code++;
+    }
+  }
+  out[code_at] = code;
+  out[size++] = 0;
+  return size;
+}
+
+/// @brief Decode one COBS packet (delimiter excluded) in place
+/// @return Decoded length, or 0 if the packet is malformed
+constexpr size_t CobsDecode(uint8_t* data, size_t length) {
+  size_t in = 0;
+  size_t out = 0;
+  while (in < length) {
+    uint8_t code = data[in++];
+    if (code == 0 || in + code - 1 > length) {
+      return 0;
+    }
+    for (int i = 1; i < code; i++) {
+      data[out++] = data[in++];
+    }
+    if (code != 0xFF && in < length) {
+      data[out++] = 0;
+    }
+  }
+  return out;
+}
+
+/// @brief A decoded record; which member is valid depends on `type`
+struct Record {
+  RecordType type;
+  Frame frame;  // time_us holds the low 16 bits only
+  Sync sync;
+};
+
+/// @brief Check the CRC and the length of a decoded record and parse it
+constexpr bool DecodeRecord(uint8_t const* data, size_t length,
+                            Record& record) {
+  if (length < 3 ||
+      Crc16(data, length - 2) != Get(data + length - 2, 2)) {
+    return false;
+  }
+  length -= 2;
+
+  auto header = data[0];
+  record.type = static_cast<RecordType>(header >> kTypeShift);
+  if (record.type == kSyncRecord) {
+    if (length != 17) {
+      return false;
+    }
+    record.sync = {.time_us = Get(data + 1, 4),
+                   .frames = Get(data + 5, 4),
+                   .dropped = Get(data + 9, 4),
+                   .overruns = Get(data + 13, 4)};
+    return true;
+  }
+  if (record.type != kFrameRecord) {
+    return false;
+  }
+
+  auto& frame = record.frame;
+  frame.extended = header & kExtendedBit;
+  frame.remote = header & kRemoteBit;
+  frame.length = header & kLengthMask;
+  int id_bytes = frame.extended ? 4 : 2;
+  size_t data_bytes = frame.remote ? 0 : frame.length;
+  if (frame.length > 8 || length != 3 + id_bytes + data_bytes) {
+    return false;
+  }
+  frame.time_us = Get(data + 1, 2);
+  frame.id = Get(data + 3, id_bytes);
+  frame.data = {};
+  for (size_t i = 0; i < data_bytes; i++) {
+    frame.data[i] = data[3 + id_bytes + i];
+  }
+  return true;
+}
+}  // namespace CANMonitor::capture
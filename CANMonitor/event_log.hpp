@@ -3,5 +3,6 @@
 #include "f3/eventlog.hpp"
 
 namespace CANMonitor {
-static inline EventLog<10> kEventLog;
+// The RAM of EventLog<10>: ~45 events of one argument, ~28 CAN Rx events
+static inline DeferredEventLog<560> kEventLog;
 }
\ No newline at end of file
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+
+#include <f3/critical_section.hpp>
+#include <f3/format.hpp>
+
+#include "utils.hpp"
+
+extern "C" char _sstack;
+
+namespace CANMonitor {
+//* Formatting microbenchmark
+//  Cycles per call (DWT CYCCNT) and peak stack of newlib-nano snprintf
+//  against stm32f3::FormatTo on the strings CANMonitor formats. The stack
+//  below the caller is painted and scanned for the deepest byte touched.
+//  Needs the cycle counter to be running. newlib-nano has no %f unless
+//  linked with -u _printf_float, so the float case runs FormatTo only.
+
+class FormatBench {
+  static constexpr int kRounds = 64;
+  static constexpr uint8_t kPaint = 0xA5;
+  static constexpr size_t kMaxStack = 1024;
+
+  struct Result {
+    unsigned int cycles;
+    unsigned int stack;  // [bytes]
+  };
+
+  static inline std::array<char, 128> buffer_;
+  static inline volatile unsigned int sink_;
+
+  template <typename Fn>
+  [[gnu::noinline]] static Result Measure(Fn&& fn) {
+    Result result;
+    {
+      stm32f3::CriticalSection lock;  // Interrupts would add their frames
+      auto sp = reinterpret_cast<uint8_t*>(__get_MSP());
+      auto bottom =
+          std::max(sp - kMaxStack, reinterpret_cast<uint8_t*>(&_sstack));
+      for (auto p = static_cast<uint8_t volatile*>(bottom); p < sp; p++) {
+        *p = kPaint;
+      }
+      sink_ = fn();
+      auto p = static_cast<uint8_t volatile*>(bottom);
+      while (p < sp && *p == kPaint) {
+        p++;
+      }
+      result.stack = sp - p;
+    }
+
+    auto start = DWT->CYCCNT;
+    for (int round = 0; round < kRounds; round++) {
+      sink_ = fn();
+    }
+    result.cycles = (DWT->CYCCNT - start) / kRounds;
+    return result;
+  }
+
+  static void Report(char const* name, Result printf_result,
+                     Result format_result) {
+    printf("  %-8s snprintf %5u cyc %4u B   FormatTo %5u cyc %4u B" NEWLINE,
+           name, printf_result.cycles, printf_result.stack,
+           format_result.cycles, format_result.stack);
+  }
+
+ public:
+  void Main() {
+    printf("Formatting (per call)" NEWLINE);
+
+    // A CanDebug table row
+    int tick = 1234;
+    uint32_t id = 0x18FF1234;
+    unsigned int count = 4711;
+    unsigned int period = 10000;
+    char const* payload = "01 23 45 67 89 AB CD EF ";
+    Report(
+        "row",
+        Measure([&] {
+          return snprintf(buffer_.data(), buffer_.size(),
+                          "%8d] %08X%c(%5u) %3u %8u %8u %8u %6u %2u.%u%%: %s",
+                          tick, (unsigned int)id, 'x', count, 131u, period,
+                          period - 12, period + 9, 7u, 13u, 1u, payload);
+        }),
+        Measure([&] {
+          return stm32f3::FormatTo<"{:8}] {:08X}{}({:5}) {:3} {:8} {:8} {:8} "
+                                   "{:6} {:2}.{}%: {}">(
+              buffer_, tick, id, 'x', count, 131u, period, period - 12,
+              period + 9, 7u, 13u, 1u, payload);
+        }));
+
+    // Screen cursor movement
+    unsigned int row = 12;
+    unsigned int col = 57;
+    Report("escape",
+           Measure([&] {
+             return snprintf(buffer_.data(), buffer_.size(), "\x1b[%u;%uH",
+                             row, col);
+           }),
+           Measure([&] {
+             return stm32f3::FormatTo<"\x1b[{};{}H">(buffer_, row, col);
+           }));
+
+    Report("hex",
+           Measure([&] {
+             return snprintf(buffer_.data(), buffer_.size(), "%08X",
+                             (unsigned int)id);
+           }),
+           Measure([&] { return stm32f3::FormatTo<"{:08X}">(buffer_, id); }));
+
+    float volts = 12.345f;
+    auto fixed = Measure(
+        [&] { return stm32f3::FormatTo<"{:8.3f} V">(buffer_, volts); });
+    printf("  %-8s snprintf %5s cyc %4s B   FormatTo %5u cyc %4u B" NEWLINE,
+           "float", "-", "-", fixed.cycles, fixed.stack);
+  }
+};
+}  // namespace CANMonitor
@@ -1,33 +1,53 @@
 #include "can.hpp"
+#include "capture.hpp"
 #include "can_debug.hpp"
 #include "can_debug_seq.hpp"
 #include "event_log.hpp"
 #include "rcc.hpp"
+#include "slcan.hpp"
 
 #include <f3/console.hpp>
 
-using App = CanDebug;
-// using App = CANMonitor::CANDebug_Seq;
-
 struct HardwareConfig {
   using RCCConfig = CANMonitor::BaremetalRCC;
 
   using ConsoleTx = stm32f3::GPIO<0, 2>;
   using ConsoleRx = stm32f3::GPIO<0, 15>;
-  static constexpr uint32_t kConsoleBaudrate = 921600;
+  static constexpr uint32_t kConsoleBaudrate = CANMonitor::kConsoleBaudrate;
   static constexpr uint32_t kConsoleUARTAltFn = 7;
   static constexpr uint32_t kConsoleUARTId = 2;
   static constexpr size_t kConsoleRxBufSize = 0;
+  static constexpr size_t kConsoleTxBufSize = 512;
+  static constexpr auto kConsoleTxPolicy = stm32f3::ConsoleTxPolicy::kBlock;
+};
+
+struct SLCANHardwareConfig : HardwareConfig {
+  static constexpr uint32_t kConsoleBaudrate = CANMonitor::kSLCANBaudrate;
+  static constexpr size_t kConsoleRxBufSize = 64;
+  static constexpr size_t kConsoleTxBufSize = 0;  // Writes the USART directly
 };
 
+struct CaptureHardwareConfig : HardwareConfig {
+  static constexpr uint32_t kConsoleBaudrate = CANMonitor::kCaptureBaudrate;
+  static constexpr size_t kConsoleTxBufSize = 0;  // Writes the USART directly
+};
+
+using App = CanDebug;
+using AppHardware = HardwareConfig;
+// using App = CANMonitor::CANDebug_Seq;
+// using App = CANMonitor::SLCAN<SLCANHardwareConfig>;
+// using AppHardware = SLCANHardwareConfig;
+// using App = CANMonitor::Capture<CaptureHardwareConfig>;
+// using AppHardware = CaptureHardwareConfig;
+
 int main() {
   stm32::InitRCC();
-  stm32f3::Console<HardwareConfig>::Init();
+  stm32f3::Console<AppHardware>::Init();
   CANMonitor::InitCAN();
 
-  CANMonitor::kEventLog.Log("Is RCC Initialized?: %d",
-                            CANMonitor::rcc_initialized);
+  CANMonitor::kEventLog.Log<"Is RCC Initialized?: {}">(
+      CANMonitor::rcc_initialized);
 
   App app;
   app.Main();
-}
\ No newline at end of file
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <f3/peripherals/can_analysis.hpp>
+
+//* Periodic frames sent by CANMonitor
+//  Kept free of device headers so tools/can_schedule_report can analyse it.
+//  The heartbeat is the 29-bit 0x555 frame CANDebug_Seq always sent; the
+//  status and telemetry frames exercise the offset planning.
+
+namespace CANMonitor::schedule {
+using stm32f3::can::CANPeriodic;
+
+static constexpr int kBitrate = 1e6;
+
+static constexpr CANPeriodic kHeartbeat = {
+    .id = 0x555, .extended = true, .length = 5, .period_ms = 10};
+static constexpr CANPeriodic kStatus = {
+    .id = 0x556, .length = 8, .period_ms = 100};
+static constexpr CANPeriodic kTelemetry = {
+    .id = 0x557, .length = 8, .period_ms = 100};
+
+using Table = stm32f3::can::CANTraffic<kHeartbeat, kStatus, kTelemetry>;
+}  // namespace CANMonitor::schedule
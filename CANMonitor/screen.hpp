@@ -0,0 +1,291 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <f3/console.hpp>
+#include <f3/format.hpp>
+
+namespace CANMonitor {
+static constexpr uint32_t kConsoleBaudrate = 921600;
+
+//* Dirty-region terminal renderer
+//  Apps hand over whole rows every frame; only the cells that changed since
+//  the last frame go out, with the shortest cursor movement, within a byte
+//  budget per frame. Rows that did not fit stay Pending() for the next frame.
+//
+//  The last rendered content is kept as a 16-bit hash per kChunk cells
+//  (1.2 KiB for 48 x 104 instead of 5 KiB of cells). Emission is exact:
+//  a changed chunk is written from the new row, and the unchanged cells
+//  between two spans are re-sent from it too. One row is fully repainted
+//  every kRefreshFrames frames, which repairs hash collisions and a
+//  terminal that was reset or reconnected.
+
+struct ScreenStatistic {
+  unsigned int frames;
+  unsigned int bytes;
+  unsigned int deferred_frames;  // Frames that ran out of budget
+};
+
+/// @tparam kBaudrate UART bit rate the budget is derived from (8N1)
+/// @note The terminal must be wider than kCols (no auto-wrap at the edge)
+template <size_t kRows, size_t kCols, uint32_t kBaudrate = kConsoleBaudrate>
+class Screen {
+ public:
+  static constexpr size_t kChunk = 8;
+  static constexpr uint32_t kMinPeriodMs = 10;
+  static constexpr uint32_t kMaxPeriodMs = 160;
+  static constexpr int kRefreshFrames = 16;
+
+ private:
+  static_assert(kCols % kChunk == 0);
+  static constexpr size_t kChunks = kCols / kChunk;
+  static constexpr uint32_t kBytesPerMs = kBaudrate / 10 / 1000;
+  static_assert(kBytesPerMs > 0);
+
+  // Share of each frame period the UART may be busy
+  static constexpr uint32_t kBudgetPercent = 50;
+
+  static constexpr size_t kNoColumn = SIZE_MAX;
+
+  static constexpr uint16_t Hash(char const* cells) {
+    uint32_t hash = 2166136261u;  // FNV-1a
+    for (size_t i = 0; i < kChunk; i++) {
+      hash = (hash ^ static_cast<uint8_t>(cells[i])) * 16777619u;
+    }
+    return hash ^ (hash >> 16);
+  }
+
+  static constexpr uint16_t kBlankHash = [] {
+    std::array<char, kChunk> blank = {};
+    blank.fill(' ');
+    return Hash(blank.data());
+  }();
+
+  std::array<std::array<uint16_t, kChunks>, kRows> hashes_ = {};
+  std::array<bool, kRows> pending_ = {};
+  std::array<char, kCols + 1> line_ = {};
+  std::array<char, 64> out_ = {};
+  size_t out_size_ = 0;
+
+  size_t cursor_row_ = 0;
+  size_t cursor_col_ = kNoColumn;
+
+  uint32_t period_ms_ = kMinPeriodMs;
+  uint32_t frame_bytes_ = 0;
+  uint32_t backlog_bytes_ = 0;  // Console TX backlog when the frame began
+  bool over_budget_ = false;
+  size_t resume_row_ = 0;  // First row served after a deferred frame
+  size_t refresh_row_ = 0;  // Repainted in full once, then the next one
+  bool refreshing_ = false;
+  bool refresh_seen_ = false;  // The app handed over refresh_row_
+  int refresh_countdown_ = kRefreshFrames;
+
+  ScreenStatistic statistic_ = {};
+
+  [[nodiscard]] uint32_t Budget() const {
+    return period_ms_ * kBytesPerMs * kBudgetPercent / 100;
+  }
+
+  void Flush() {
+    stm32f3::format::ConsoleWriter::Write(out_.data(), out_size_);
+    out_size_ = 0;
+  }
+
+  void Put(char const* data, size_t length) {
+    frame_bytes_ += length;
+    while (length > 0) {
+      if (out_size_ == out_.size()) {
+        Flush();
+      }
+      auto n = std::min(length, out_.size() - out_size_);
+      std::copy_n(data, n, out_.data() + out_size_);
+      out_size_ += n;
+      data += n;
+      length -= n;
+    }
+  }
+
+  template <stm32f3::format::FixedString kFormat, typename... Args>
+  void PutEscape(Args const&... args) {
+    std::array<char, 16> buffer;
+    Put(buffer.data(), stm32f3::FormatTo<kFormat>(buffer, args...));
+  }
+
+  /// @brief Move the cursor to (row, col); `line_` holds the row's content
+  void MoveTo(size_t row, size_t col) {
+    if (row == cursor_row_ && cursor_col_ != kNoColumn && col >= cursor_col_) {
+      auto gap = col - cursor_col_;
+      if (gap <= 4) {  // Unchanged cells are cheaper than "\x1b[nC"
+        Put(line_.data() + cursor_col_, gap);
+      } else {
+        PutEscape<"\x1b[{}C">(gap);
+      }
+    } else {
+      PutEscape<"\x1b[{};{}H">(row + 1, col + 1);
+    }
+    cursor_row_ = row;
+    cursor_col_ = col;
+  }
+
+  /// @brief Upper bound of the bytes MoveTo + cells [begin, end) need
+  static constexpr uint32_t SpanCost(size_t begin, size_t end) {
+    return 10 + (end - begin);  // "\x1b[rr;cccH" + cells
+  }
+
+ public:
+  /// @brief Clear the terminal and forget its content
+  void Clear() {
+    for (auto& row : hashes_) {
+      row.fill(kBlankHash);
+    }
+    pending_.fill(false);
+    Put("\x1b[2J\x1b[?25l", 10);
+    cursor_col_ = kNoColumn;
+  }
+
+  void BeginFrame() {
+    frame_bytes_ = 0;
+    backlog_bytes_ = stm32f3::ConsoleTxBacklog();
+    if (!over_budget_) {
+      resume_row_ = 0;
+    }
+    over_budget_ = false;
+    refresh_seen_ = false;
+
+    if (!refreshing_ && --refresh_countdown_ == 0) {
+      refresh_countdown_ = kRefreshFrames;
+      refresh_row_ = (refresh_row_ + 1) % kRows;
+      refreshing_ = true;
+      pending_[refresh_row_] = true;
+    }
+  }
+
+  /// @brief The row still differs from the terminal; hand it over again
+  [[nodiscard]] bool Pending(size_t row) const {
+    return row < kRows && pending_[row];
+  }
+
+  /// @brief Set the content of a row (up to the first '\n'; padded)
+  void Text(size_t row, char const* text, size_t length) {
+    if (row >= kRows) {
+      return;
+    }
+
+    length = std::min(length, kCols);
+    auto end = std::find(text, text + length, '\n');
+    if (text != line_.data()) {
+      std::copy(text, end, line_.begin());
+    }
+    std::fill(line_.begin() + (end - text), line_.end() - 1, ' ');
+    line_[kCols] = '\0';
+
+    // Cells after `blank_from` are all blank and can be erased with "\x1b[K"
+    size_t blank_from = kCols;
+    while (blank_from > 0 && line_[blank_from - 1] == ' ') {
+      blank_from--;
+    }
+
+    // Rows before resume_row_ were served by the previous (deferred) frame
+    bool deferred = over_budget_ || row < resume_row_;
+    bool dirty = false;
+    bool repaint = refreshing_ && row == refresh_row_;
+    refresh_seen_ = refresh_seen_ || repaint;
+    auto changed = [&](size_t c) {
+      return repaint || Hash(&line_[c * kChunk]) != hashes_[row][c];
+    };
+
+    size_t chunk = 0;
+    while (chunk < kChunks) {
+      if (!changed(chunk)) {
+        chunk++;
+        continue;
+      }
+
+      auto first = chunk;
+      while (chunk < kChunks && changed(chunk)) {
+        chunk++;
+      }
+      auto begin = first * kChunk;
+      auto span_end = chunk * kChunk;
+
+      if (deferred || frame_bytes_ + SpanCost(begin, span_end) > Budget()) {
+        if (!deferred) {
+          over_budget_ = true;
+          resume_row_ = row;
+          deferred = true;
+        }
+        dirty = true;
+        continue;
+      }
+
+      MoveTo(row, begin);
+      if (span_end > blank_from) {
+        // The rest of the row is blank: erase it and take every chunk
+        Put(line_.data() + begin, std::max(begin, blank_from) - begin);
+        Put("\x1b[K", 3);
+        cursor_col_ = std::max(begin, blank_from);
+        for (size_t c = first; c < kChunks; c++) {
+          hashes_[row][c] = Hash(&line_[c * kChunk]);
+        }
+        break;
+      }
+
+      Put(line_.data() + begin, span_end - begin);
+      cursor_col_ = span_end == kCols ? kNoColumn : span_end;
+      for (size_t c = first; c < chunk; c++) {
+        hashes_[row][c] = Hash(&line_[c * kChunk]);
+      }
+    }
+
+    pending_[row] = dirty;
+    if (repaint && !dirty) {
+      refreshing_ = false;
+    }
+  }
+
+  /// @brief Format a row in place (see f3/format.hpp)
+  template <stm32f3::format::FixedString kFormat, typename... Args>
+  void Print(size_t row, Args const&... args) {
+    Text(row, line_.data(), stm32f3::FormatTo<kFormat>(line_, args...));
+  }
+
+  /// @brief Flush the frame and adapt the frame period to what changed
+  /// @return Milliseconds to wait before the next frame, less the time the
+  ///         line spent on bytes that left during the frame (bytes still in
+  ///         the console's TX ring drain while the app waits)
+  uint32_t EndFrame() {
+    Flush();
+
+    // A row the app does not draw has nothing to repair: move on
+    if (refreshing_ && !refresh_seen_) {
+      refreshing_ = false;
+      pending_[refresh_row_] = false;
+    }
+
+    statistic_.frames++;
+    statistic_.bytes += frame_bytes_;
+    if (over_budget_) {
+      statistic_.deferred_frames++;
+      period_ms_ = std::min(period_ms_ * 2, kMaxPeriodMs);
+    } else if (frame_bytes_ < Budget() / 4) {
+      period_ms_ = std::max(period_ms_ / 2, kMinPeriodMs);
+    }
+
+    // Other writers may have queued bytes too: never count below zero
+    uint32_t queued = backlog_bytes_ + frame_bytes_;
+    uint32_t backlog = stm32f3::ConsoleTxBacklog();
+    auto sent = queued - std::min(queued, backlog);
+    auto busy_ms = sent / kBytesPerMs;
+    return period_ms_ - std::min(period_ms_, busy_ms);
+  }
+
+  static constexpr size_t Rows() { return kRows; }
+  static constexpr size_t Cols() { return kCols; }
+
+  [[nodiscard]] uint32_t PeriodMs() const { return period_ms_; }
+  [[nodiscard]] ScreenStatistic GetStatistic() const { return statistic_; }
+};
+}  // namespace CANMonitor
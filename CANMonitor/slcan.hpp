@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <f3/console.hpp>
+#include <f3/critical_section.hpp>
+#include <f3/peripherals/can.hpp>
+
+#include "can.hpp"
+#include "can_stats.hpp"
+#include "rcc.hpp"
+#include "slcan_protocol.hpp"
+
+namespace CANMonitor {
+/// Console speed of the SLCAN adapter: the longest line (extended, DLC 8,
+/// timestamp: 31 bytes = 124 us) must leave before the shortest frame of
+/// that kind (131 bit times at 1 Mbit/s) is received, so that a saturated
+/// bus can be logged. USB-UART bridges and slcand -S both support it.
+static constexpr uint32_t kSLCANBaudrate = 2500000;
+
+//* SLCAN adapter
+//  Runs AppCAN behind the Lawicel protocol on the console USART, so that
+//  Linux slcand/can-utils see CANMonitor as a serial CAN interface:
+//    slcand -o -s8 -S2500000 /dev/ttyACM0 slcan0 && ip link set up slcan0
+//  The RX interrupt only copies frames into a ring; the main loop formats
+//  them and writes the console back to back.
+
+template <stm32f3::ConsoleConfig Config>
+class SLCAN {
+  using Console = stm32f3::Console<Config>;
+  static_assert(Config::kConsoleRxBufSize != 0,
+                "SLCAN reads commands from the console");
+
+  struct RxEntry {
+    SLCANFrame frame;
+    uint16_t time_ms;
+  };
+
+  template <stm32f3::can::CANMode kMode, size_t... I>
+  static constexpr auto MakeTimings(std::index_sequence<I...>) {
+    return std::array<uint32_t, sizeof...(I)>{
+        AppCAN::BitTiming<BaremetalRCC, slcan::kBitrates[I], kMode>()...};
+  }
+  static constexpr auto kIndices =
+      std::make_index_sequence<slcan::kBitrates.size()>();
+  static constexpr auto kNormalTimings =
+      MakeTimings<stm32f3::can::CANMode::kNormal>(kIndices);
+  static constexpr auto kSilentTimings =
+      MakeTimings<stm32f3::can::CANMode::kSilent>(kIndices);
+
+  struct Device {
+    static bool Open(uint32_t bitrate, bool listen_only) {
+      auto rate = std::find(slcan::kBitrates.begin(), slcan::kBitrates.end(),
+                            bitrate);
+      if (rate == slcan::kBitrates.end()) {
+        return false;
+      }
+      auto index = rate - slcan::kBitrates.begin();
+      AppCAN::Restart(listen_only ? kSilentTimings[index]
+                                  : kNormalTimings[index]);
+      open_ = true;
+      return true;
+    }
+
+    static void Close() {
+      open_ = false;
+      AppCAN::Stop();
+    }
+
+    static bool Send(SLCANFrame const& frame) {
+      stm32f3::can::CANMessage message{
+          .id = frame.id,
+          .length = frame.length,
+          .data = frame.data,
+          .extended = frame.extended,
+          .remote = frame.remote,
+      };
+      if (!AppCAN::Send(message)) {
+        tx_full_ = true;
+        return false;
+      }
+      return true;
+    }
+
+    /// @brief Flags since the last call
+    static uint8_t StatusFlags() {
+      auto errors = AppCAN::GetErrorStatistic();
+      auto overruns = errors.fifo_overrun[0] + errors.fifo_overrun[1] +
+                      rx_ring_.Overflow();
+      auto bus_errors = errors.bus_off_events + errors.lec_events[1] +
+                        errors.lec_events[2] + errors.lec_events[3] +
+                        errors.lec_events[4] + errors.lec_events[5] +
+                        errors.lec_events[6];
+
+      uint8_t flags = 0;
+      if (rx_ring_.Size() == kRxRingDepth) {
+        flags |= kSLCANRxFull;
+      }
+      if (tx_full_) {
+        flags |= kSLCANTxFull;
+      }
+      if (errors.ewgf) {
+        flags |= kSLCANErrorWarning;
+      }
+      if (overruns != overruns_) {
+        flags |= kSLCANDataOverrun;
+      }
+      if (errors.epvf) {
+        flags |= kSLCANErrorPassive;
+      }
+      if (bus_errors != bus_errors_ || errors.boff) {
+        flags |= kSLCANBusError;
+      }
+
+      tx_full_ = false;
+      overruns_ = overruns;
+      bus_errors_ = bus_errors;
+      return flags;
+    }
+  };
+
+  /// @brief Millisecond counter for the 'Z' timestamps, modulo
+  ///        kTimestampWrapMs (MicroClock / 1000 would jump at its 2^32 us
+  ///        wrap); must be called at least once per MicroClock wrap
+  static uint16_t TimestampMs() {
+    stm32f3::CriticalSection lock;  // RX interrupt and main loop
+    auto now = MicroClock::Now();
+    sub_ms_us_ += now - last_us_;
+    last_us_ = now;
+    time_ms_ = (time_ms_ + sub_ms_us_ / 1000) % slcan::kTimestampWrapMs;
+    sub_ms_us_ %= 1000;
+    return static_cast<uint16_t>(time_ms_);
+  }
+
+  static void Write(char const* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+      Console::UART::WriteBuffered(data[i]);
+    }
+  }
+
+  static void HandleRx(int, stm32f3::can::CANMessage const& msg) {
+    if (!open_) {
+      return;
+    }
+
+    RxEntry entry{
+        .frame = {.id = msg.id,
+                  .length = static_cast<uint8_t>(std::min<uint32_t>(
+                      msg.length, 8)),  // DLC 9..15 carry 8 bytes
+                  .extended = msg.extended,
+                  .remote = msg.remote,
+                  .data = msg.data},
+        .time_ms = TimestampMs(),
+    };
+    rx_ring_.Push(entry);
+  }
+
+ public:
+  SLCAN() {
+    AppCAN::Stop();  // Closed until the host sends 'O' or 'L'
+    MicroClock::Init();
+    last_us_ = MicroClock::Now();
+    Handler::Init(HandleRx, [] {});
+  }
+
+  [[noreturn]] void Main() {
+    SLCANProtocol<Device> protocol;
+
+    while (true) {
+      for (auto span = Console::Rx::Peek(); !span.empty();
+           span = Console::Rx::Peek()) {
+        for (auto c : span) {
+          protocol.Input(static_cast<char>(c), Write);
+        }
+        Console::Rx::Consume(span.size());
+      }
+
+      RxEntry entry;
+      if (!rx_ring_.Pop(entry)) {
+        TimestampMs();  // Keep the clocks extended on an idle bus
+        continue;
+      }
+
+      std::array<char, slcan::kMaxLine> line;
+      auto length = slcan::Encode(entry.frame, protocol.Timestamps(),
+                                  entry.time_ms, line.data());
+      Write(line.data(), length);
+    }
+  }
+
+ private:
+  static constexpr size_t kRxRingDepth = 64;
+
+  static inline volatile bool open_ = false;
+  static inline bool tx_full_ = false;
+  static inline unsigned int overruns_ = 0;
+  static inline unsigned int bus_errors_ = 0;
+  static inline stm32f3::can::CANRxRing<kRxRingDepth, RxEntry> rx_ring_;
+
+  static inline uint32_t last_us_ = 0;    // MicroClock at the last update
+  static inline uint32_t sub_ms_us_ = 0;  // Not yet counted in time_ms_
+  static inline uint32_t time_ms_ = 0;
+};
+}  // namespace CANMonitor
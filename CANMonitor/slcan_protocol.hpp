@@ -0,0 +1,291 @@
+#pragma once
+
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+
+//* SLCAN (Lawicel) protocol
+//  The ASCII serial-line CAN adapter protocol spoken by Linux slcand and
+//  can-utils. Only depends on the standard library, so tools/slcan_pty can
+//  run the same engine behind a pseudo-terminal.
+//
+//  Host -> adapter (each command ends with '\r'):
+//    Sn            Bit rate: 0=10k 1=20k 2=50k 3=100k 4=125k 5=250k 6=500k
+//                  7=800k 8=1M (channel closed only)
+//    O / L / C     Open / open listen-only / close the channel
+//    tiiildd..     Send a standard (11-bit) frame, answers "z\r"
+//    Tiiiiiiiildd. Send an extended (29-bit) frame, answers "Z\r"
+//    riiil/Riiiiiiiil  Send a remote frame
+//    Zn            Timestamps off/on (4 hex digits of ms, wraps at 60000)
+//    F             Status flags (SLCANStatus), cleared by reading
+//    V / N         Version / serial number
+//    Mxxxxxxxx / mxxxxxxxx  Acceptance code / mask (accepted, not applied)
+//  Answers are '\r' (OK) or '\a' (error). Received frames are sent as
+//  t/T/r/R lines in the same format.
+
+namespace CANMonitor {
+struct SLCANFrame {
+  uint32_t id;
+  uint8_t length;
+  bool extended;
+  bool remote;
+  std::array<uint8_t, 8> data;
+};
+
+/// @brief Bits of the 'F' command answer
+enum SLCANStatus : uint8_t {
+  kSLCANRxFull = 1 << 0,
+  kSLCANTxFull = 1 << 1,
+  kSLCANErrorWarning = 1 << 2,
+  kSLCANDataOverrun = 1 << 3,
+  kSLCANErrorPassive = 1 << 5,
+  kSLCANArbitrationLost = 1 << 6,
+  kSLCANBusError = 1 << 7,
+};
+
+namespace slcan {
+static constexpr char kOk = '\r';
+static constexpr char kError = '\a';
+
+/// Longest line: 'T' + 8 + 1 + 16 + 4 (timestamp) + '\r'
+static constexpr size_t kMaxLine = 31;
+
+static constexpr std::array<uint32_t, 9> kBitrates = {
+    10000, 20000, 50000, 100000, 125000, 250000, 500000, 800000, 1000000};
+
+static constexpr uint32_t kTimestampWrapMs = 60000;
+
+constexpr char* PutHex(char* out, uint32_t value, int digits) {
+  for (int i = digits - 1; i >= 0; i--) {
+    *out++ = "0123456789ABCDEF"[(value >> (4 * i)) & 0xF];
+  }
+  return out;
+}
+
+constexpr bool ParseHex(char const* in, int digits, uint32_t& value) {
+  value = 0;
+  for (int i = 0; i < digits; i++) {
+    auto c = in[i];
+    uint32_t nibble;
+    if ('0' <= c && c <= '9') {
+      nibble = c - '0';
+    } else if ('A' <= c && c <= 'F') {
+      nibble = c - 'A' + 10;
+    } else if ('a' <= c && c <= 'f') {
+      nibble = c - 'a' + 10;
+    } else {
+      return false;
+    }
+    value = value << 4 | nibble;
+  }
+  return true;
+}
+
+/// @brief Format a received frame as a t/T/r/R line
+/// @return Length of the line, including the final '\r'
+constexpr size_t Encode(SLCANFrame const& frame, bool timestamp,
+                        uint16_t time_ms, char* out) {
+  auto begin = out;
+  *out++ = frame.remote ? (frame.extended ? 'R' : 'r')
+                        : (frame.extended ? 'T' : 't');
+  out = PutHex(out, frame.id, frame.extended ? 8 : 3);
+  *out++ = static_cast<char>('0' + frame.length);
+  if (!frame.remote) {
+    for (size_t i = 0; i < frame.length && i < 8; i++) {
+      out = PutHex(out, frame.data[i], 2);
+    }
+  }
+  if (timestamp) {
+    out = PutHex(out, time_ms, 4);
+  }
+  *out++ = '\r';
+  return out - begin;
+}
+
+/// @brief Parse a t/T/r/R command (without the '\r')
+constexpr bool Decode(char const* line, size_t length, SLCANFrame& frame) {
+  if (length == 0) {
+    return false;
+  }
+  auto type = line[0];
+  frame.extended = type == 'T' || type == 'R';
+  frame.remote = type == 'r' || type == 'R';
+
+  size_t id_digits = frame.extended ? 8 : 3;
+  if (length < 1 + id_digits + 1) {
+    return false;
+  }
+
+  uint32_t id = 0;
+  if (!ParseHex(line + 1, id_digits, id) ||
+      id > (frame.extended ? 0x1FFFFFFFu : 0x7FFu)) {
+    return false;
+  }
+
+  auto dlc = line[1 + id_digits];
+  if (dlc < '0' || '8' < dlc) {
+    return false;
+  }
+  frame.id = id;
+  frame.length = dlc - '0';
+  frame.data = {};
+
+  auto data = line + 2 + id_digits;
+  size_t data_digits = frame.remote ? 0 : 2 * frame.length;
+  if (length != 2 + id_digits + data_digits) {
+    return false;
+  }
+  for (size_t i = 0; i < data_digits / 2; i++) {
+    uint32_t byte = 0;
+    if (!ParseHex(data + 2 * i, 2, byte)) {
+      return false;
+    }
+    frame.data[i] = byte;
+  }
+  return true;
+}
+}  // namespace slcan
+
+/// @brief The CAN side of an SLCAN adapter
+template <typename T>
+concept SLCANDeviceLike = requires(SLCANFrame const& frame) {
+  {T::Open(uint32_t{}, bool{})}->std::same_as<bool>;
+  {T::Close()}->std::same_as<void>;
+  {T::Send(frame)}->std::same_as<bool>;
+  {T::StatusFlags()}->std::convertible_to<uint8_t>;
+};
+
+/// @brief Command parser of an SLCAN adapter
+/// @details Input() takes the host's bytes one at a time and passes each
+///          answer to `reply(char const* data, size_t length)`.
+template <SLCANDeviceLike Device>
+class SLCANProtocol {
+  std::array<char, slcan::kMaxLine> line_ = {};
+  size_t size_ = 0;
+  bool overflow_ = false;  // Line too long: answered with kError at '\r'
+
+  bool open_ = false;
+  bool listen_only_ = false;
+  bool timestamps_ = false;
+  uint32_t bitrate_;
+
+  static constexpr char kOkReply[] = {slcan::kOk};
+  static constexpr char kErrorReply[] = {slcan::kError};
+
+  template <typename Reply>
+  void Execute(char const* line, size_t length, Reply&& reply) {
+    auto ok = [&] { reply(kOkReply, 1); };
+    auto error = [&] { reply(kErrorReply, 1); };
+
+    if (length == 0) {
+      ok();  // slcand sends empty lines to flush the adapter's buffer
+      return;
+    }
+
+    switch (line[0]) {
+      case 'S':
+        if (length != 2 || open_ || line[1] < '0' ||
+            line[1] >= static_cast<char>('0' + slcan::kBitrates.size())) {
+          return error();
+        }
+        bitrate_ = slcan::kBitrates[line[1] - '0'];
+        return ok();
+
+      case 'O':
+      case 'L':
+        if (length != 1 || open_ || !Device::Open(bitrate_, line[0] == 'L')) {
+          return error();
+        }
+        open_ = true;
+        listen_only_ = line[0] == 'L';
+        return ok();
+
+      case 'C':
+        if (open_) {
+          Device::Close();
+          open_ = false;
+        }
+        return ok();
+
+      case 't':
+      case 'T':
+      case 'r':
+      case 'R': {
+        SLCANFrame frame{};
+        if (!open_ || listen_only_ || !slcan::Decode(line, length, frame) ||
+            !Device::Send(frame)) {
+          return error();
+        }
+        char const answer[] = {frame.extended ? 'Z' : 'z', slcan::kOk};
+        reply(answer, 2);
+        return;
+      }
+
+      case 'F': {
+        if (!open_) {
+          return error();
+        }
+        char answer[4] = {'F'};
+        slcan::PutHex(answer + 1, Device::StatusFlags(), 2);
+        answer[3] = slcan::kOk;
+        reply(answer, 4);
+        return;
+      }
+
+      case 'Z':
+        if (length != 2 || (line[1] != '0' && line[1] != '1')) {
+          return error();
+        }
+        timestamps_ = line[1] == '1';
+        return ok();
+
+      case 'V':
+        reply("V1013\r", 6);
+        return;
+
+      case 'N':
+        reply("NF303\r", 6);
+        return;
+
+      case 'M':
+      case 'm':
+        // The hardware filters stay as configured (accept all)
+        return length == 9 ? ok() : error();
+
+      default:
+        return error();
+    }
+  }
+
+ public:
+  explicit SLCANProtocol(uint32_t bitrate = 1000000) : bitrate_(bitrate) {}
+
+  [[nodiscard]] bool IsOpen() const { return open_; }
+  [[nodiscard]] bool Timestamps() const { return timestamps_; }
+  [[nodiscard]] uint32_t Bitrate() const { return bitrate_; }
+
+  template <typename Reply>
+  void Input(char c, Reply&& reply) {
+    if (c == '\n') {
+      return;
+    }
+    if (c != '\r') {
+      if (size_ == line_.size()) {
+        overflow_ = true;
+      } else {
+        line_[size_++] = c;
+      }
+      return;
+    }
+
+    if (overflow_) {
+      reply(kErrorReply, 1);
+    } else {
+      Execute(line_.data(), size_, reply);
+    }
+    size_ = 0;
+    overflow_ = false;
+  }
+};
+}  // namespace CANMonitor
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+
+#include <Nano/fixed_map.hpp>
+
+#include "can_id_table.hpp"
+#include "utils.hpp"
+
+namespace CANMonitor {
+//* ID table microbenchmark
+//  Cycles per lookup (DWT CYCCNT) of the Nano FixedMap CanDebug used to keep
+//  against CANIdTable, for hits on a table filled with `n` identifiers.
+//  Needs the cycle counter to be running.
+
+class TableBench {
+  static constexpr int kRounds = 16;
+
+  struct Value {
+    std::array<uint8_t, 8> data;
+    uint16_t rx_count;
+  };
+
+  /// @brief Identifiers spread like a real bus (clustered, some extended)
+  static constexpr uint32_t IdOf(uint32_t i) {
+    return i % 4 == 3 ? 0x18FF0000 + i * 0x101 : 0x100 + i * 3;
+  }
+  static constexpr bool IsExtended(uint32_t i) { return i % 4 == 3; }
+
+  template <typename Fn>
+  static unsigned int CyclesPerCall(uint32_t n, Fn&& fn) {
+    auto start = DWT->CYCCNT;
+    for (int round = 0; round < kRounds; round++) {
+      for (uint32_t i = 0; i < n; i++) {
+        fn(i);
+      }
+    }
+    return (DWT->CYCCNT - start) / (kRounds * n);
+  }
+
+  static void BenchFixedMap() {
+    static Nano::collection::FixedMap<uint32_t, Value, 32> map;
+    for (uint32_t i = 0; i < 32; i++) {
+      map[IdOf(i)] = Value{};
+    }
+
+    volatile uint16_t sink = 0;
+    auto cycles = CyclesPerCall(32, [&](uint32_t i) {
+      if (map.Contains(IdOf(i))) {
+        sink = map[IdOf(i)].rx_count;
+      }
+    });
+    printf("  FixedMap<32>       n=%3d: %5u cycles/lookup" NEWLINE, 32,
+           cycles);
+  }
+
+  template <size_t kCapacity>
+  static void BenchTable(uint32_t n) {
+    static CANIdTable<Value, kCapacity> table;
+    table.Clear();
+
+    uint32_t stored = 0;
+    for (uint32_t i = 0; i < n; i++) {
+      stored += table.FindOrInsert(IdOf(i), IsExtended(i)).first != nullptr;
+    }
+
+    volatile uint16_t sink = 0;
+    auto cycles = CyclesPerCall(n, [&](uint32_t i) {
+      if (auto* value = table.Find(IdOf(i), IsExtended(i))) {
+        sink = value->rx_count;
+      }
+    });
+    printf("  CANIdTable<%3d>    n=%3u: %5u cycles/lookup (%u stored)" NEWLINE,
+           (int)kCapacity, (unsigned int)n, cycles, (unsigned int)stored);
+  }
+
+ public:
+  void Main() {
+    printf("ID table lookup" NEWLINE);
+    BenchFixedMap();
+    BenchTable<64>(32);
+    BenchTable<256>(32);
+    BenchTable<256>(128);
+    BenchTable<256>(200);
+  }
+};
+}  // namespace CANMonitor
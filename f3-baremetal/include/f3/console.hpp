@@ -1,10 +1,17 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <f3/critical_section.hpp>
+#include <f3/peripherals/dma.hpp>
 #include <f3/peripherals/gpio.hpp>
 #include <f3/peripherals/rcc.hpp>
 #include <f3/peripherals/usart.hpp>
-
-#include <Nano/queue.hpp>
+#include <f3/peripherals/usart_rx_dma.hpp>
+#include <f3/ram_vector.hpp>
 
 namespace stm32f3::details::Console {
 template <typename T>
@@ -21,6 +28,8 @@ concept ConsoleConfig = requires {
 
 auto write(int /*fd*/, char* ptr, int len) -> int;
 auto read(int /*fd*/, char* ptr, int len) -> int;
+auto tx_backlog() -> size_t;
+auto tx_flush() -> void;
 
 // NOLINTNEXTLINE
 extern "C" auto _write(int fd, char* ptr, int len) -> int {
@@ -32,25 +41,201 @@ extern "C" auto _read(int fd, char* ptr, int len) -> int {
   return read(fd, ptr, len);
 }
 
-template <size_t kRxBufSize>
+// NOLINTNEXTLINE
+extern "C" auto _console_flush() -> void { tx_flush(); }
+
+// RX runs on DMA (USARTRxDMA); the per-byte interrupt path is unused
 struct Handler {
-  static void HandleRx(char received_char) { rx_buffer.Push(received_char); }
+  static void HandleRx(char /*received_char*/) {}
+};
 
-  // NOLINTNEXTLINE
-  static inline Nano::collection::Queue<char, kRxBufSize> rx_buffer{};
+/// @brief What a write does when the TX buffer cannot take all of it
+enum class TxPolicy {
+  kBlock,     // Wait for the DMA to free space
+  kDrop,      // Drop the whole write
+  kTruncate,  // Queue what fits, drop the rest
 };
 
-template <>
-struct Handler<0> {
-  static void HandleRx(char /*received_char*/) {}
+struct TxStatistic {
+  uint32_t bytes;            // Queued
+  uint32_t dropped_bytes;    // Lost to kDrop / kTruncate
+  uint32_t dropped_writes;   // Writes that lost bytes
+  uint32_t blocked_writes;   // Writes that waited (kBlock)
+  uint32_t high_water;       // Most bytes ever pending
+  uint32_t dma_errors;       // Transfer errors (their bytes are lost)
+};
+
+/// @brief TX ring drained by the USART's TX DMA channel
+/// @details Writers copy into the ring under a CriticalSection and return;
+///          each DMA transfer sends the contiguous pending bytes, and its
+///          completion interrupt starts the next one. Space held by the
+///          transfer in flight is reclaimed from CNDTR as it drains.
+///          Writes from interrupts are safe; with kBlock they poll the DMA
+///          flags, so they also make progress with interrupts masked.
+template <typename UART, size_t kSize, TxPolicy kPolicy>
+class DMATx {
+  static_assert((kSize & (kSize - 1)) == 0, "Size must be a power of two");
+  using Dma = stm32f3::DMA<1>;
+  static constexpr int kChannel = UART::kTxDMAChannel;
+
+  static inline std::array<uint8_t, kSize> buffer_ = {};
+  static inline uint32_t written_ = 0;    // Bytes queued, free running
+  static inline uint32_t released_ = 0;   // Bytes of finished transfers
+  static inline uint32_t in_flight_ = 0;  // Length of the running transfer
+  static inline TxStatistic statistic_ = {};
+
+  static DMA_Channel_TypeDef* Channel() { return Dma::ChannelBase(kChannel); }
+
+  /// @note Call inside a CriticalSection
+  static uint32_t Pending() {
+    auto sent = in_flight_ == 0 ? 0 : in_flight_ - Channel()->CNDTR;
+    return written_ - released_ - sent;
+  }
+
+  /// @note Call inside a CriticalSection
+  static void StartTransfer() {
+    auto used = written_ - released_;
+    if (in_flight_ != 0 || used == 0) {
+      return;
+    }
+    auto start = released_ % kSize;
+    in_flight_ = std::min<uint32_t>(used, kSize - start);
+
+    Channel()->CCR = 0;
+    Channel()->CMAR = static_cast<uint32_t>(
+        reinterpret_cast<uintptr_t>(&buffer_[start]));
+    Channel()->CNDTR = in_flight_;
+    Channel()->CCR = DMA_CCR_MINC | DMA_CCR_DIR | DMA_CCR_TCIE |
+                     DMA_CCR_TEIE | DMA_CCR_EN;
+  }
+
+  /// @brief Retire a finished transfer and start the next one
+  static void Service() {
+    CriticalSection lock;
+    auto flags = Dma::Flags(kChannel);
+    if (!(flags & (Dma::kCompleteFlag | Dma::kErrorFlag))) {
+      return;
+    }
+    Dma::ClearFlags(kChannel, Dma::kGlobalFlag | Dma::kCompleteFlag |
+                                   Dma::kHalfFlag | Dma::kErrorFlag);
+    if (flags & Dma::kErrorFlag) {
+      statistic_.dma_errors++;
+    }
+    released_ += in_flight_;
+    in_flight_ = 0;
+    StartTransfer();
+  }
+
+  /// @return Bytes copied
+  static size_t Enqueue(uint8_t const* data, size_t length) {
+    CriticalSection lock;
+    auto count = std::min<size_t>(length, kSize - Pending());
+    if (kPolicy == TxPolicy::kDrop && count < length) {
+      return 0;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      buffer_[(written_ + i) % kSize] = data[i];
+    }
+    written_ += count;
+    statistic_.bytes += count;
+    statistic_.high_water =
+        std::max<uint32_t>(statistic_.high_water, written_ - released_);
+    StartTransfer();
+    return count;
+  }
+
+ public:
+  static void Init() {
+    Dma::Init();
+    Channel()->CCR = 0;
+    Channel()->CPAR = static_cast<uint32_t>(
+        reinterpret_cast<uintptr_t>(&UART::Instance()->TDR));
+    UART::EnableTxDMA();
+
+    auto irqn = Dma::ChannelIRQn(kChannel);
+    ram_vector::ram_vector[16 + irqn] = &DMATx::Service;
+    NVIC_EnableIRQ(irqn);
+  }
+
+  static void Write(uint8_t const* data, size_t length) {
+    auto queued = Enqueue(data, length);
+    if (queued == length) {
+      return;
+    }
+
+    if constexpr (kPolicy == TxPolicy::kBlock) {
+      statistic_.blocked_writes++;
+      while (queued < length) {
+        Service();
+        queued += Enqueue(data + queued, length - queued);
+      }
+    } else {
+      CriticalSection lock;
+      statistic_.dropped_bytes += length - queued;
+      statistic_.dropped_writes++;
+    }
+  }
+
+  /// @brief Wait until every queued byte has left the USART
+  static void Flush() {
+    while (true) {
+      Service();
+      CriticalSection lock;
+      if (written_ == released_) {
+        break;
+      }
+    }
+    UART::WaitIdle();
+  }
+
+  /// @brief Bytes queued that have not left the ring yet
+  static uint32_t Backlog() {
+    CriticalSection lock;
+    return Pending();
+  }
+
+  static TxStatistic GetStatistic() {
+    CriticalSection lock;
+    return statistic_;
+  }
 };
 
+/// @brief Optional config members: kConsoleTxBufSize (0: blocking writes)
+///        and kConsoleTxPolicy (default kBlock)
+template <typename Config>
+consteval size_t TxBufSize() {
+  if constexpr (requires { Config::kConsoleTxBufSize; }) {
+    return Config::kConsoleTxBufSize;
+  } else {
+    return 0;
+  }
+}
+
+template <typename Config>
+consteval TxPolicy TxPolicyOf() {
+  if constexpr (requires { Config::kConsoleTxPolicy; }) {
+    return Config::kConsoleTxPolicy;
+  } else {
+    return TxPolicy::kBlock;
+  }
+}
+
 template <ConsoleConfig Config>
 struct Console {
+  using UART = stm32f3::USART<Config::kConsoleUARTId, Handler>;
+
+  /// Kernel clock, divider and error of kConsoleBaudrate
+  static constexpr usart::BaudSetting kBaud =
+      UART::template SolveBaudrate<Config::kConsoleBaudrate,
+                                   typename Config::RCCConfig>();
 
-  using HandlerT = Handler<Config::kConsoleRxBufSize>;
+  /// kConsoleRxBufSize (a power of two) bytes of circular DMA buffer
+  static constexpr size_t kRxBufSize = Config::kConsoleRxBufSize;
+  using Rx = USARTRxDMA<UART, std::max<size_t>(kRxBufSize, 1)>;
 
-  using UART = stm32f3::USART<Config::kConsoleUARTId, HandlerT>;
+  static constexpr size_t kTxBufSize = TxBufSize<Config>();
+  using Tx = DMATx<UART, std::max<size_t>(kTxBufSize, 1), TxPolicyOf<Config>()>;
 
   static void Init() {
     Config::ConsoleTx::template InitAsAF<Config::kConsoleUARTAltFn>();
@@ -58,26 +243,90 @@ struct Console {
 
     UART::template Configure<Config::kConsoleBaudrate,
                              typename Config::RCCConfig>();
-    // UART::EnableRxInterrupt();
+    if constexpr (kRxBufSize != 0) {
+      Rx::Init();
+    }
     UART::Start();
+    if constexpr (kTxBufSize != 0) {
+      Tx::Init();
+    }
+  }
+
+  /// @brief Wait until everything written so far has been sent
+  static void Flush() {
+    if constexpr (kTxBufSize != 0) {
+      Tx::Flush();
+    } else {
+      UART::WaitIdle();
+    }
+  }
+
+  /// @brief Bytes written that are still waiting for the line
+  ///        (0 without a TX buffer: writes return once sent)
+  static size_t TxBacklog() {
+    if constexpr (kTxBufSize != 0) {
+      return Tx::Backlog();
+    } else {
+      return 0;
+    }
+  }
+
+  static TxStatistic GetTxStatistic() {
+    static_assert(kTxBufSize != 0, "No console TX buffer");
+    return Tx::GetStatistic();
+  }
+
+  /// @brief Non-blocking read of one received character
+  /// @note  Rx::Peek() / Rx::Consume() read whole spans in place
+  static bool TryRead(char& c) {
+    static_assert(kRxBufSize != 0, "No console RX buffer");
+    uint8_t byte;
+    if (!Rx::TryRead(byte)) {
+      return false;
+    }
+    c = static_cast<char>(byte);
+    return true;
+  }
+
+  static USARTRxStatistic GetRxStatistic() {
+    static_assert(kRxBufSize != 0, "No console RX buffer");
+    return Rx::GetStatistic();
   }
 
   friend auto write(int /*fd*/, char* ptr, int len) -> int {
-    for (int i = 0; i < len; ++i) {
-      UART::Write(ptr[i]);
+    if constexpr (kTxBufSize != 0) {
+      // Dropped bytes are reported as written: newlib retries short writes
+      Tx::Write(reinterpret_cast<uint8_t const*>(ptr), len);
+    } else {
+      for (int i = 0; i < len; ++i) {
+        UART::Write(ptr[i]);
+      }
     }
     return len;
   }
 
+  friend auto tx_backlog() -> size_t { return TxBacklog(); }
+  friend auto tx_flush() -> void { Flush(); }
+
+  /// Waits for the first byte, then returns what has arrived (up to len)
   friend auto read(int /*fd*/, char* ptr, int len) -> int {
-    if constexpr (Config::kConsoleRxBufSize == 0) {
+    if constexpr (kRxBufSize == 0) {
       return 0;
     } else {
-      for (int i = 0; i < len; ++i) {
-        while (HandlerT::rx_buffer.Empty()) {}
-        ptr[i] = HandlerT::rx_buffer.Pop();
+      std::span<uint8_t const> span = Rx::Peek();
+      while (span.empty()) {
+        span = Rx::Peek();
+      }
+
+      int count = 0;
+      while (count < len && !span.empty()) {
+        size_t n = std::min<size_t>(span.size(), len - count);
+        std::copy_n(span.data(), n, ptr + count);
+        Rx::Consume(n);
+        count += n;
+        span = Rx::Peek();
       }
-      return len;
+      return count;
     }
   }
 };
@@ -89,4 +338,10 @@ concept ConsoleConfig = details::Console::ConsoleConfig<T>;
 
 template <ConsoleConfig Config>
 using Console = details::Console::Console<Config>;
+
+using ConsoleTxPolicy = details::Console::TxPolicy;
+using ConsoleTxStatistic = details::Console::TxStatistic;
+
+/// @brief Console<Config>::TxBacklog() of the console in use
+inline size_t ConsoleTxBacklog() { return details::Console::tx_backlog(); }
 }  // namespace stm32f3
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+
+#include <stm32f3xx.h>
+
+namespace stm32f3 {
+/// @brief Masks all maskable interrupts while alive (restores PRIMASK on exit)
+class CriticalSection {
+  uint32_t primask_;
+
+ public:
+  CriticalSection() : primask_(__get_PRIMASK()) { __disable_irq(); }
+  ~CriticalSection() { __set_PRIMASK(primask_); }
+
+  CriticalSection(CriticalSection const&) = delete;
+  CriticalSection& operator=(CriticalSection const&) = delete;
+};
+}  // namespace stm32f3
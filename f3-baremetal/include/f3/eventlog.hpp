@@ -1,13 +1,20 @@
 #pragma once
 
-#include <cstdarg>
+#include <algorithm>
+#include <array>
 #include <cstddef>
 #include <cstdint>
-#include <cstdio>
 #include <cstring>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 #include <stm32f3xx.h>
 
+#include <f3/critical_section.hpp>
+#include <f3/format.hpp>
+
 extern "C" void TIM6_DAC1_IRQHandler();
 
 template <size_t kDepth>
@@ -25,6 +32,15 @@ class EventLog {
   Entry kEventLogPool[kDepth];
   Entry* kEventLogHead;
 
+  /// @brief Take the oldest entry (interrupts may log too)
+  Entry* Claim() {
+    stm32f3::CriticalSection lock;
+    auto log = kEventLogHead;
+    kEventLogHead = kEventLogHead->next;
+    log->timestamp = tick;
+    return log;
+  }
+
  public:
   uint32_t tick = 0;
 
@@ -42,25 +58,18 @@ class EventLog {
   }
 
   void LogRaw(const char* line) {
-    auto log = kEventLogHead;
-    kEventLogHead = kEventLogHead->next;
-
-    log->timestamp = tick;
+    auto log = Claim();
     for (int i = 0; i < sizeof(log->message) - 1; i++) {
       log->message[i] = line[i];
       if (line[i] == 0)
         break;
     }
   }
-  void Log(const char* fmt, ...) {
-    va_list args;
-    va_start(args, fmt);
-
-    static char buffer[0x30];
-    vsnprintf(buffer, sizeof(buffer), fmt, args);
-    LogRaw(buffer);
 
-    va_end(args);
+  /// @brief Format straight into the entry (see f3/format.hpp)
+  template <stm32f3::format::FixedString kFormat, typename... Args>
+  void Log(Args const&... args) {
+    stm32f3::FormatTo<kFormat>(Claim()->message, args...);
   }
 
   //* Iterator
@@ -90,4 +99,201 @@ class EventLog {
 
   Iterator begin() { return Iterator(kEventLogHead, kEventLogHead); }
   Iterator end() { return Iterator(nullptr, kEventLogHead); }
+
+  /// @brief fn(timestamp, message) for every entry, oldest first
+  template <typename Fn>
+  void ForEach(Fn&& fn) {
+    for (auto log : *this) {
+      fn(log->timestamp, static_cast<char const*>(log->message));
+    }
+  }
+};
+
+namespace stm32f3::eventlog {
+using Word = uintptr_t;  // 32 bits on the target
+
+/// Per format string and argument types, in flash
+struct Format {
+  size_t (*render)(Word const* args, std::span<char> out);
+  uint16_t words;  // Record size: format, timestamp and arguments
+};
+
+template <format::FixedString kFormat, typename... Args>
+struct FormatOf {
+  static_assert((std::is_trivially_copyable_v<Args> && ...),
+                "Deferred arguments are copied as raw bytes");
+
+  static constexpr size_t kArgBytes = (size_t{0} + ... + sizeof(Args));
+  static constexpr size_t kWords =
+      2 + (kArgBytes + sizeof(Word) - 1) / sizeof(Word);
+
+  static size_t Render(Word const* words, std::span<char> out) {
+    auto bytes = reinterpret_cast<uint8_t const*>(words);
+    return [&]<size_t... I>(std::index_sequence<I...>) {
+      std::tuple<Args...> args;
+      size_t offset = 0;
+      ((std::memcpy(&std::get<I>(args), bytes + offset, sizeof(Args)),
+        offset += sizeof(Args)),
+       ...);
+      return FormatTo<kFormat>(out, std::get<I>(args)...);
+    }(std::index_sequence_for<Args...>());
+  }
+
+  static constexpr Format kDescriptor = {
+      .render = &Render, .words = static_cast<uint16_t>(kWords)};
+};
+}  // namespace stm32f3::eventlog
+
+/// @brief EventLog that formats on read
+/// @details Log() stores a pointer to the format's descriptor, the tick and
+///          the raw argument bytes into a ring of variable-length records,
+///          overwriting the oldest; it costs a few stores instead of a
+///          formatting pass, so interrupts can log. ForEach()/Dump() format
+///          the records. Pointer arguments are followed at that time: pass
+///          string literals or other static text only.
+/// @tparam kBytes Ring size; a record takes 8 bytes + its arguments, rounded
+///               up to 4 (EventLog takes 56 bytes per entry)
+template <size_t kBytes>
+class DeferredEventLog {
+  using Word = stm32f3::eventlog::Word;
+  using Format = stm32f3::eventlog::Format;
+
+  static constexpr size_t kWords = kBytes / sizeof(Word);
+  static constexpr size_t kMaxRecordWords = 8;
+  static constexpr size_t kMessageSize = 64;
+  static_assert(kWords >= 2 * kMaxRecordWords, "Ring too small");
+
+  std::array<Word, kWords> ring_ = {};  // 0 pads the end of the ring
+  size_t head_ = 0;                     // Next record
+  size_t tail_ = 0;                     // Oldest record
+  size_t used_ = 0;                     // Words, padding included
+  uint32_t evicted_ = 0;                // Words evicted, free running
+  uint32_t dropped_ = 0;                // Records overwritten
+
+  size_t RecordWords(size_t index) const {
+    auto header = ring_[index];
+    return header == 0 ? kWords - index
+                       : reinterpret_cast<Format const*>(header)->words;
+  }
+
+  void Evict() {
+    auto words = RecordWords(tail_);
+    dropped_ += ring_[tail_] != 0;
+    evicted_ += words;
+    used_ -= words;
+    tail_ = tail_ + words == kWords ? 0 : tail_ + words;
+  }
+
+  /// @brief Claim `words` contiguous words, evicting the oldest records
+  Word* Reserve(size_t words) {
+    if (kWords - head_ < words) {  // Pad to the end and start over
+      auto padding = kWords - head_;
+      while (kWords - used_ < padding) {
+        Evict();
+      }
+      ring_[head_] = 0;
+      used_ += padding;
+      head_ = 0;
+    }
+    while (kWords - used_ < words) {
+      Evict();
+    }
+
+    auto record = &ring_[head_];
+    used_ += words;
+    head_ = head_ + words == kWords ? 0 : head_ + words;
+    return record;
+  }
+
+ public:
+  uint32_t tick = 0;
+
+  /// @brief Record the event; formatted by ForEach() (see f3/format.hpp)
+  template <stm32f3::format::FixedString kFormat, typename... Args>
+  void Log(Args const&... args) {
+    using FormatOf =
+        stm32f3::eventlog::FormatOf<kFormat, std::decay_t<Args const>...>;
+    static_assert(FormatOf::kWords <= kMaxRecordWords, "Too many arguments");
+
+    stm32f3::CriticalSection lock;
+    auto record = Reserve(FormatOf::kWords);
+    record[0] = reinterpret_cast<Word>(&FormatOf::kDescriptor);
+    record[1] = tick;
+
+    if constexpr (sizeof...(Args) > 0) {
+      auto bytes = reinterpret_cast<uint8_t*>(record + 2);
+      size_t offset = 0;
+      auto put = [&](auto const& value) {
+        std::memcpy(bytes + offset, &value, sizeof(value));
+        offset += sizeof(value);
+      };
+      (put(static_cast<std::decay_t<Args const>>(args)), ...);
+    }
+  }
+
+  /// @brief fn(timestamp, message) for the newest `last` events, oldest
+  ///        first; events overwritten meanwhile are skipped
+  template <typename Fn>
+  void ForEach(Fn&& fn, size_t last = SIZE_MAX) {
+    uint32_t position;
+    size_t count = 0;
+    {
+      stm32f3::CriticalSection lock;
+      for (size_t offset = 0; offset < used_;) {
+        auto index = (tail_ + offset) % kWords;
+        count += ring_[index] != 0;
+        offset += RecordWords(index);
+      }
+
+      // Skip the events before the newest `last`
+      position = evicted_;
+      for (size_t skip = count > last ? count - last : 0; skip > 0;) {
+        auto index = (tail_ + (position - evicted_)) % kWords;
+        skip -= ring_[index] != 0;
+        position += RecordWords(index);
+      }
+      count = std::min(count, last);
+    }
+
+    while (count > 0) {
+      std::array<Word, kMaxRecordWords> record;
+      {
+        stm32f3::CriticalSection lock;
+        auto offset = position - evicted_;
+        if (offset > used_) {  // Overwritten: continue at the oldest
+          offset = 0;
+          position = evicted_;
+        }
+        if (offset == used_) {
+          break;
+        }
+
+        auto index = (tail_ + offset) % kWords;
+        auto words = RecordWords(index);
+        position += words;
+        if (ring_[index] == 0) {
+          continue;
+        }
+        std::copy_n(&ring_[index], words, record.begin());
+      }
+
+      std::array<char, kMessageSize> message;
+      reinterpret_cast<Format const*>(record[0])->render(record.data() + 2,
+                                                         message);
+      fn(static_cast<uint32_t>(record[1]),
+         static_cast<char const*>(message.data()));
+      count--;
+    }
+  }
+
+  /// @brief Print every event to the console (see stm32f3::Print)
+  void Dump() {
+    ForEach([](uint32_t timestamp, char const* message) {
+      stm32f3::Print<"{:8}: {}\n">(timestamp, message);
+    });
+  }
+
+  /// @brief Records overwritten to make room, whether or not ForEach()
+  ///        had shown them
+  [[nodiscard]] uint32_t Dropped() const { return dropped_; }
 };
@@ -0,0 +1,553 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+//* Compile-time formatting
+//  A std::format subset without heap, locale, varargs or stdio. The format
+//  string is a template argument, parsed and checked against the argument
+//  types at compile time; only the conversions it uses are instantiated:
+//    stm32f3::FormatTo<"{:08X} {:>5} {:.2f}">(buffer, id, count, volts);
+//    stm32f3::Print<"{} frames\n">(frames);  // Console, through _write
+//
+//  Field: {} or {:[[fill]align][+][#][0][width][.precision][type]}
+//    align     < (strings), > (numbers), ^
+//    type      d x X b o   integers (c: as a character)
+//              c           char (d x X b o: as an integer)
+//              s           strings, bool; .precision truncates
+//              f           float/double, fixed point, .precision 0..9 (6),
+//                          rounded half up
+//    #         0x / 0X / 0b / 0 prefix, '.' even with .0
+//  Arguments are used in order; "{{" and "}}" are literal braces.
+
+extern "C" int _write(int fd, char* ptr, int len);
+extern "C" void _console_flush();  // Defined by f3/console.hpp
+
+namespace stm32f3::format {
+template <size_t N>
+struct FixedString {
+  char data[N] = {};
+
+  consteval FixedString(char const (&string)[N]) {  // NOLINT
+    std::copy_n(string, N, data);
+  }
+
+  [[nodiscard]] consteval std::string_view View() const {
+    return {data, N - 1};
+  }
+};
+
+enum class Align : uint8_t {
+  kDefault,
+  kLeft,
+  kRight,
+  kCenter,
+};
+
+struct Spec {
+  char fill = ' ';
+  Align align = Align::kDefault;
+  bool plus = false;
+  bool alternate = false;
+  bool zero = false;
+  uint8_t width = 0;
+  int8_t precision = -1;
+  char type = 0;
+};
+
+/// Literal text of the format string, followed by a field if arg >= 0
+struct Segment {
+  uint16_t begin;
+  uint16_t length;
+  int8_t arg;
+  Spec spec;
+};
+
+/// @brief Not constexpr: reaching it fails the compile-time parse
+inline void FormatError(char const* /*message*/) {}
+
+template <size_t kMaxSegments>
+struct ParseResult {
+  std::array<Segment, kMaxSegments> segments = {};
+  size_t count = 0;
+  int args = 0;
+};
+
+consteval bool IsDigit(char c) { return '0' <= c && c <= '9'; }
+
+consteval Align AlignOf(char c) {
+  return c == '<'   ? Align::kLeft
+         : c == '>' ? Align::kRight
+         : c == '^' ? Align::kCenter
+                    : Align::kDefault;
+}
+
+/// @brief Parse the spec in [i, '}') of `s`
+consteval Spec ParseSpec(std::string_view s, size_t& i) {
+  Spec spec;
+  auto at = [&](size_t j) { return j < s.size() ? s[j] : '\0'; };
+
+  if (at(i) != '}' && AlignOf(at(i + 1)) != Align::kDefault) {
+    spec.fill = at(i);
+    spec.align = AlignOf(at(i + 1));
+    i += 2;
+  } else if (AlignOf(at(i)) != Align::kDefault) {
+    spec.align = AlignOf(at(i));
+    i++;
+  }
+  if (at(i) == '+') {
+    spec.plus = true;
+    i++;
+  }
+  if (at(i) == '#') {
+    spec.alternate = true;
+    i++;
+  }
+  if (at(i) == '0') {
+    spec.zero = true;
+    i++;
+  }
+
+  int width = 0;
+  while (IsDigit(at(i))) {
+    width = width * 10 + (at(i++) - '0');
+    if (width > 255) {
+      FormatError("Field width over 255");
+    }
+  }
+  spec.width = width;
+
+  if (at(i) == '.') {
+    i++;
+    if (!IsDigit(at(i))) {
+      FormatError("Missing precision after '.'");
+    }
+    int precision = 0;
+    while (IsDigit(at(i))) {
+      precision = precision * 10 + (at(i++) - '0');
+      if (precision > 127) {
+        FormatError("Precision over 127");
+      }
+    }
+    spec.precision = precision;
+  }
+
+  if (std::string_view("dxXbocsf").find(at(i)) != std::string_view::npos) {
+    spec.type = at(i++);
+  }
+  if (at(i) != '}') {
+    FormatError("Invalid format spec or missing '}'");
+  }
+  return spec;
+}
+
+template <FixedString kFormat>
+consteval auto Parse() {
+  constexpr auto s = kFormat.View();
+  static_assert(s.size() < 0x10000, "Format string too long");
+
+  ParseResult<s.size() + 1> result;
+  size_t begin = 0;
+  auto emit = [&](size_t end, int arg, Spec spec) {
+    result.segments[result.count++] = {
+        .begin = static_cast<uint16_t>(begin),
+        .length = static_cast<uint16_t>(end - begin),
+        .arg = static_cast<int8_t>(arg),
+        .spec = spec};
+  };
+
+  size_t i = 0;
+  while (i < s.size()) {
+    auto c = s[i];
+    if (c != '{' && c != '}') {
+      i++;
+      continue;
+    }
+    if (i + 1 < s.size() && s[i + 1] == c) {  // "{{" or "}}"
+      emit(i + 1, -1, {});
+      i += 2;
+      begin = i;
+      continue;
+    }
+    if (c == '}') {
+      FormatError("Single '}' in format string");
+    }
+
+    auto end = i;
+    i++;
+    Spec spec;
+    if (i < s.size() && s[i] == ':') {
+      i++;
+      spec = ParseSpec(s, i);
+    } else if (i >= s.size() || s[i] != '}') {
+      FormatError("Missing '}' or unsupported argument index");
+    }
+    if (result.args >= 127) {
+      FormatError("Too many fields");
+    }
+    emit(end, result.args++, spec);
+    i++;
+    begin = i;
+  }
+  if (begin < s.size() || result.count == 0) {
+    emit(s.size(), -1, {});
+  }
+  return result;
+}
+
+template <FixedString kFormat>
+struct Parsed {
+  static constexpr auto kResult = Parse<kFormat>();
+  static constexpr int kArgs = kResult.args;
+  static constexpr auto kSegments = [] {
+    std::array<Segment, kResult.count> segments;
+    std::copy_n(kResult.segments.begin(), kResult.count, segments.begin());
+    return segments;
+  }();
+};
+
+template <typename W>
+concept Writer = requires(W w, char const* data, size_t length) {
+  w.Put(data, length);
+};
+
+template <Writer W>
+void PutFill(W& writer, char fill, size_t count) {
+  std::array<char, 8> chunk;
+  chunk.fill(fill);
+  while (count > 0) {
+    auto n = std::min(count, chunk.size());
+    writer.Put(chunk.data(), n);
+    count -= n;
+  }
+}
+
+/// @brief Pad `prefix` + `body` (sign/0x, digits) to the field width
+template <Writer W>
+void PutPadded(W& writer, Spec const& spec, Align fallback,
+               std::string_view prefix, std::string_view body) {
+  auto length = prefix.size() + body.size();
+  size_t padding = spec.width > length ? spec.width - length : 0;
+
+  if (spec.zero && spec.align == Align::kDefault) {  // Sign-aware zeros
+    writer.Put(prefix.data(), prefix.size());
+    PutFill(writer, '0', padding);
+    writer.Put(body.data(), body.size());
+    return;
+  }
+
+  auto align = spec.align == Align::kDefault ? fallback : spec.align;
+  size_t before = align == Align::kRight    ? padding
+                  : align == Align::kCenter ? padding / 2
+                                            : 0;
+  PutFill(writer, spec.fill, before);
+  writer.Put(prefix.data(), prefix.size());
+  writer.Put(body.data(), body.size());
+  PutFill(writer, spec.fill, padding - before);
+}
+
+/// @brief Digits of `value` ending at `end`
+/// @return First digit
+template <unsigned kBase, bool kUpper, std::unsigned_integral U>
+char* RenderDigits(char* end, U value) {
+  constexpr char const* kDigits =
+      kUpper ? "0123456789ABCDEF" : "0123456789abcdef";
+  do {
+    *--end = kDigits[value % kBase];
+    value /= kBase;
+  } while (value != 0);
+  return end;
+}
+
+template <char kType, std::unsigned_integral U>
+char* RenderInteger(char* end, U value) {
+  // 32-bit division is a single instruction; keep 64-bit values off it
+  // unless they need it
+  if constexpr (sizeof(U) > sizeof(uint32_t)) {
+    if (value <= UINT32_MAX) {
+      return RenderInteger<kType>(end, static_cast<uint32_t>(value));
+    }
+  }
+  switch (kType) {
+    case 'x':
+      return RenderDigits<16, false>(end, value);
+    case 'X':
+      return RenderDigits<16, true>(end, value);
+    case 'b':
+      return RenderDigits<2, false>(end, value);
+    case 'o':
+      return RenderDigits<8, false>(end, value);
+    default:
+      return RenderDigits<10, false>(end, value);
+  }
+}
+
+template <char kType>
+consteval std::string_view BasePrefix() {
+  return kType == 'x'   ? "0x"
+         : kType == 'X' ? "0X"
+         : kType == 'b' ? "0b"
+         : kType == 'o' ? "0"
+                        : "";
+}
+
+template <Spec kSpec, Writer W, std::integral T>
+void PutInteger(W& writer, T value) {
+  static_assert(std::string_view("\0dxXbo", 6).find(kSpec.type) !=
+                    std::string_view::npos,
+                "Integers take d, x, X, b, o or c");
+  static_assert(kSpec.precision < 0, "Integers have no precision");
+
+  using U = std::make_unsigned_t<decltype(+value)>;
+  bool negative = false;
+  U magnitude = static_cast<U>(value);
+  if constexpr (std::is_signed_v<T>) {
+    negative = value < 0;
+    magnitude = negative ? U(0) - magnitude : magnitude;
+  }
+
+  std::array<char, sizeof(U) * 8> digits;
+  auto end = digits.data() + digits.size();
+  auto begin = RenderInteger<kSpec.type>(end, magnitude);
+
+  std::array<char, 3> prefix;
+  size_t prefix_length = 0;
+  if (negative || kSpec.plus) {
+    prefix[prefix_length++] = negative ? '-' : '+';
+  }
+  if constexpr (kSpec.alternate) {
+    for (auto c : BasePrefix<kSpec.type>()) {
+      prefix[prefix_length++] = c;
+    }
+  }
+  PutPadded(writer, kSpec, Align::kRight, {prefix.data(), prefix_length},
+            {begin, static_cast<size_t>(end - begin)});
+}
+
+inline constexpr std::array<uint32_t, 10> kPow10 = {
+    1,      10,      100,      1000,      10000,
+    100000, 1000000, 10000000, 100000000, 1000000000};
+
+template <Spec kSpec, Writer W, std::floating_point T>
+void PutFloat(W& writer, T value) {
+  static_assert(kSpec.type == 0 || kSpec.type == 'f',
+                "Floating-point values take f");
+  static_assert(kSpec.precision <= 9, "Float precision over 9");
+  constexpr int kPrecision = kSpec.precision < 0 ? 6 : kSpec.precision;
+  constexpr uint32_t kScale = kPow10[kPrecision];
+
+  bool negative = std::signbit(value);
+  char sign = negative ? '-' : kSpec.plus ? '+' : '\0';
+  std::string_view prefix(&sign, sign ? 1 : 0);
+  auto magnitude = negative ? -value : value;
+
+  if (magnitude != magnitude) {
+    PutPadded(writer, kSpec, Align::kRight, prefix, "nan");
+    return;
+  }
+  // Beyond 2^64 (and infinity) saturates
+  if (magnitude >= static_cast<T>(18446744073709551616.0)) {
+    PutPadded(writer, kSpec, Align::kRight, prefix, "inf");
+    return;
+  }
+
+  // The FPU converts to 32 bits; 64-bit conversions are library calls
+  uint64_t integer;
+  if (magnitude < static_cast<T>(4294967296.0)) {
+    integer = static_cast<uint32_t>(magnitude);
+  } else {
+    integer = static_cast<uint64_t>(magnitude);
+  }
+  auto fraction = static_cast<uint32_t>(
+      (magnitude - static_cast<T>(integer)) * kScale + static_cast<T>(0.5));
+  if (fraction >= kScale) {
+    fraction -= kScale;
+    integer++;
+  }
+
+  std::array<char, 20 + 1 + 9> digits;
+  auto end = digits.data() + digits.size();
+  auto begin = end;
+  if constexpr (kPrecision > 0) {
+    begin = end - kPrecision;
+    std::fill(begin, end, '0');
+    RenderInteger<'d'>(end, fraction);
+  }
+  if constexpr (kPrecision > 0 || kSpec.alternate) {
+    *--begin = '.';
+  }
+  begin = RenderInteger<'d'>(begin, integer);
+
+  PutPadded(writer, kSpec, Align::kRight, prefix,
+            {begin, static_cast<size_t>(end - begin)});
+}
+
+template <Spec kSpec, Writer W>
+void PutString(W& writer, std::string_view value) {
+  static_assert(kSpec.type == 0 || kSpec.type == 's', "Strings take s");
+  static_assert(!kSpec.plus && !kSpec.alternate && !kSpec.zero,
+                "Strings take no +, # or 0");
+  if constexpr (kSpec.precision >= 0) {
+    value = value.substr(0, kSpec.precision);
+  }
+  PutPadded(writer, kSpec, Align::kLeft, {}, value);
+}
+
+template <Spec kSpec, Writer W, typename T>
+void PutArg(W& writer, T const& value) {
+  if constexpr (std::is_same_v<T, bool>) {
+    PutString<kSpec>(writer, value ? "true" : "false");
+  } else if constexpr (std::is_same_v<T, char>) {
+    if constexpr (kSpec.type == 0 || kSpec.type == 'c') {
+      static_assert(kSpec.precision < 0 && !kSpec.plus && !kSpec.alternate,
+                    "Characters take no precision, + or #");
+      PutPadded(writer, kSpec, Align::kLeft, {}, {&value, 1});
+    } else {
+      PutInteger<kSpec>(writer, static_cast<unsigned char>(value));
+    }
+  } else if constexpr (std::is_integral_v<T>) {
+    if constexpr (kSpec.type == 'c') {
+      constexpr Spec kChar = [] {
+        auto spec = kSpec;
+        spec.type = 0;
+        return spec;
+      }();
+      PutArg<kChar>(writer, static_cast<char>(value));
+    } else {
+      PutInteger<kSpec>(writer, value);
+    }
+  } else if constexpr (std::is_floating_point_v<T>) {
+    PutFloat<kSpec>(writer, value);
+  } else if constexpr (std::is_convertible_v<T const&, char const*>) {
+    char const* string = value;
+    PutString<kSpec>(writer, string ? string : "(null)");
+  } else if constexpr (std::is_convertible_v<T const&, std::string_view>) {
+    PutString<kSpec>(writer, std::string_view(value));
+  } else if constexpr (std::is_pointer_v<T>) {
+    static_assert(kSpec.type == 0, "Pointers take no type");
+    constexpr Spec kHex = [] {
+      auto spec = kSpec;
+      spec.type = 'x';
+      spec.alternate = true;
+      return spec;
+    }();
+    PutInteger<kHex>(writer, reinterpret_cast<uintptr_t>(value));
+  } else {
+    static_assert(!sizeof(T), "Unsupported argument type");
+  }
+}
+
+template <FixedString kFormat, Segment kSegment, Writer W, typename... Args>
+void PutSegment(W& writer, Args const&... args) {
+  if constexpr (kSegment.length != 0) {
+    writer.Put(kFormat.data + kSegment.begin, kSegment.length);
+  }
+  if constexpr (kSegment.arg >= 0) {
+    PutArg<kSegment.spec>(writer, std::get<kSegment.arg>(std::tie(args...)));
+  }
+}
+
+/// @brief Writes into a caller buffer, truncating; keeps room for a '\0'
+class SpanWriter {
+  std::span<char> out_;
+  size_t size_ = 0;
+
+ public:
+  explicit SpanWriter(std::span<char> out) : out_(out) {}
+
+  void Put(char const* data, size_t length) {
+    auto capacity = out_.empty() ? 0 : out_.size() - 1;
+    auto n = std::min(length, capacity - size_);
+    std::copy_n(data, n, out_.data() + size_);
+    size_ += n;
+  }
+
+  /// @brief Terminate the text; returns its length
+  size_t Finish() {
+    if (!out_.empty()) {
+      out_[size_] = '\0';
+    }
+    return size_;
+  }
+};
+
+/// @brief Writes to the console (_write on fd 1) in chunks from the stack
+/// @note  Bypasses stdio: flush stdout first if it holds printf output
+class ConsoleWriter {
+  std::array<char, 32> chunk_;
+  size_t size_ = 0;
+
+ public:
+  static void Write(char const* data, size_t length) {
+    _write(1, const_cast<char*>(data), static_cast<int>(length));
+  }
+
+  ConsoleWriter() = default;
+  ConsoleWriter(ConsoleWriter const&) = delete;
+  ConsoleWriter& operator=(ConsoleWriter const&) = delete;
+  ~ConsoleWriter() { Flush(); }
+
+  void Put(char const* data, size_t length) {
+    if (size_ + length > chunk_.size()) {
+      Flush();
+      if (length >= chunk_.size()) {
+        Write(data, length);
+        return;
+      }
+    }
+    std::copy_n(data, length, chunk_.data() + size_);
+    size_ += length;
+  }
+
+  void Flush() {
+    if (size_ != 0) {
+      Write(chunk_.data(), size_);
+      size_ = 0;
+    }
+  }
+};
+}  // namespace stm32f3::format
+
+namespace stm32f3 {
+/// @brief Format into any format::Writer
+template <format::FixedString kFormat, format::Writer W, typename... Args>
+void FormatTo(W& writer, Args const&... args) {
+  using Parsed = format::Parsed<kFormat>;
+  static_assert(Parsed::kArgs == sizeof...(Args),
+                "Number of arguments does not match the format string");
+
+  [&]<size_t... I>(std::index_sequence<I...>) {
+    (format::PutSegment<kFormat, Parsed::kSegments[I]>(writer, args...), ...);
+  }(std::make_index_sequence<Parsed::kSegments.size()>());
+}
+
+/// @brief Format into `out` like snprintf, but never past it
+/// @return Length of the text, truncated to out.size() - 1 and terminated
+template <format::FixedString kFormat, typename... Args>
+size_t FormatTo(std::span<char> out, Args const&... args) {
+  format::SpanWriter writer(out);
+  FormatTo<kFormat>(writer, args...);
+  return writer.Finish();
+}
+
+/// @brief Format to the console without stdio
+template <format::FixedString kFormat, typename... Args>
+void Print(Args const&... args) {
+  format::ConsoleWriter writer;
+  FormatTo<kFormat>(writer, args...);
+}
+
+/// @brief Wait until the console has sent everything written so far
+/// @note  Fault handlers call it: a buffered console is drained by an
+///        interrupt that cannot preempt them
+inline void FlushConsole() { _console_flush(); }
+}  // namespace stm32f3
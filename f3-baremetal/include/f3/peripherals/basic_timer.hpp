@@ -129,6 +129,12 @@ class BasicTimer {
 
     Instance()->CR1 |= TIM_CR1_CEN;
   }
+
+  /// @brief Current counter value (0 .. auto_reload_value - 1)
+  static uint32_t GetCounter() { return Instance()->CNT; }
+
+  /// @brief The counter wrapped but OnTick has not run yet
+  static bool IsUpdatePending() { return Instance()->SR & TIM_SR_UIF; }
 };
 
 }  // namespace stm32f3::basic_timer
\ No newline at end of file
@@ -2,49 +2,77 @@
 
 #include <stm32f303x8.h>
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <concepts>
+#include <cstddef>
 #include <cstdint>
-#include <cstdio>
 #include <utility>
 
+#include <f3/critical_section.hpp>
+#include <f3/peripherals/can_filter.hpp>
 #include <f3/peripherals/rcc.hpp>
 #include <f3/ram_vector.hpp>
 
 namespace stm32f3::can {
 struct CANTiming {
-  uint32_t brp;
-  uint32_t ts1;
-  uint32_t ts2;
-
-  template <uint32_t apb1_freq>
-  static consteval CANTiming FindAppropriateTiming(uint32_t target) {
-    struct {
-      float error;
-      CANTiming timing;
-    } best = {.error = 1.0, .timing = {.brp = 0, .ts1 = 3, .ts2 = 1}};
-
-    for (uint32_t scale = 1; scale < 1024; scale++) {
-      // ts1 = 3, ts2 = 1 ==> (1 + ts1 + ts2) = 5
-      if ((float)apb1_freq / (float)scale / 5 != target)
-        continue;
+  uint32_t brp;      // Baud rate prescaler (1..1024)
+  uint32_t ts1;      // Time segment 1 [tq] (1..16)
+  uint32_t ts2;      // Time segment 2 [tq] (1..8)
+  uint32_t sjw = 1;  // Resynchronization jump width [tq] (1..4)
+  bool exact = false;
+
+  [[nodiscard]] constexpr uint32_t QuantaPerBit() const {
+    return 1 + ts1 + ts2;  // SYNC_SEG + BS1 + BS2
+  }
 
-      best.error = 0;
-      best.timing.brp = scale;
-      best.timing.ts1 = 3;
-      best.timing.ts2 = 1;
+  [[nodiscard]] constexpr float SamplePoint() const {
+    return (float)(1 + ts1) / (float)QuantaPerBit();
+  }
 
-      break;
-    }
+  [[nodiscard]] constexpr uint32_t Bitrate(uint32_t apb1_freq) const {
+    return apb1_freq / brp / QuantaPerBit();
+  }
 
-    if (best.error != 0) {
-      printf("Cannot find exact timing\n");
-    }
-    if (apb1_freq / best.timing.brp / (1 + best.timing.ts1 + best.timing.ts2) !=
-        target) {
-      printf("Cannot find appropriate timing\n");
+  /// @brief Searches BRP/TS1/TS2 for the exact bitrate whose sample point is
+  ///        closest to `sample_point` (ties: more quanta per bit)
+  /// @note  Check `exact` (and SamplePoint()) with static_assert
+  template <uint32_t apb1_freq>
+  static consteval CANTiming FindAppropriateTiming(
+      uint32_t target, float sample_point = 0.875f) {
+    CANTiming best = {.brp = 1, .ts1 = 1, .ts2 = 1, .sjw = 1, .exact = false};
+    float best_error = 2.0f;
+
+    for (uint32_t brp = 1; brp <= 1024; brp++) {
+      // apb1_freq = brp * (1 + ts1 + ts2) * target
+      if (target == 0 || apb1_freq % ((uint64_t)brp * target) != 0) {
+        continue;
+      }
+      auto quanta = apb1_freq / (brp * target);
+      if (quanta < 3 || 1 + 16 + 8 < quanta) {
+        continue;
+      }
+
+      for (uint32_t ts2 = 1; ts2 <= 8 && ts2 + 2 <= quanta; ts2++) {
+        CANTiming timing = {.brp = brp, .ts1 = quanta - 1 - ts2, .ts2 = ts2};
+        if (timing.ts1 > 16) {
+          continue;
+        }
+
+        auto error = timing.SamplePoint() - sample_point;
+        error = error < 0 ? -error : error;
+        if (error < best_error ||
+            (error == best_error && quanta > best.QuantaPerBit())) {
+          best_error = error;
+          best = timing;
+          best.sjw = ts2 < 4 ? ts2 : 4;
+          best.exact = true;
+        }
+      }
     }
 
-    return best.timing;
+    return best;
   }
 };
 
@@ -56,17 +84,19 @@ struct CANFilter {
   static constexpr int kScalePos = kNumber * 1;      // FS1R
   static constexpr int kScaleMask = 1 << kScalePos;  // FS1R
                                                      //
-  static constexpr int kModePos = kNumber * 1;       // FS1R
-  static constexpr int kModeMask = 1 << kModePos;    // FS1R
+  static constexpr int kModePos = kNumber * 1;       // FM1R
+  static constexpr int kModeMask = 1 << kModePos;    // FM1R
 
-  static constexpr int kFifoAssignmentPos = kNumber * 1;               // FS1R
-  static constexpr int kFifoAssignmentMask = 1 << kFifoAssignmentPos;  // FS1R
+  static constexpr int kFifoAssignmentPos = kNumber * 1;               // FFA1R
+  static constexpr int kFifoAssignmentMask = 1 << kFifoAssignmentPos;  // FFA1R
 
   static constexpr auto FilterRegister() {
     return &CAN->sFilterRegister[kNumber];
   }
 };
 
+/// @brief Single 32-bit mask bank (id/mask are register images, see
+///        CANFilterRule::Id32/Mask32). Prefer CANFilters for full setups.
 struct MaskFilter {
   uint32_t id;
   uint32_t mask;
@@ -77,14 +107,14 @@ struct MaskFilter {
 
     CAN->FA1R &= ~Filter::kActiveMask;  // Inactive
 
-    CAN->FS1R &= ~Filter::kScaleMask;     // 32-bit scale
-    Filter::FilterRegister()->FR1 = 0x0;  // ID
-    Filter::FilterRegister()->FR2 = 0x0;  // Mask
-    CAN->FM1R &= ~Filter::kModeMask;      // Mask mode
+    CAN->FS1R |= Filter::kScaleMask;       // 32-bit scale
+    Filter::FilterRegister()->FR1 = id;    // ID
+    Filter::FilterRegister()->FR2 = mask;  // Mask
+    CAN->FM1R &= ~Filter::kModeMask;       // Mask mode
 
     CAN->FFA1R &= ~Filter::kFifoAssignmentMask;  // FIFO 0
                                                  //
-    CAN->FA1R |= Filter::kActiveMask;            // Inactive
+    CAN->FA1R |= Filter::kActiveMask;            // Active
   }
 };
 
@@ -96,10 +126,23 @@ struct CANErrorStatistic {
   unsigned int epvf;  // : 1
   unsigned int ewgf;  // : 1
 
+  unsigned int fifo_full[2];     // RFxR.FULL events per RX FIFO
+  unsigned int fifo_overrun[2];  // RFxR.FOVR events (= frames lost)
+
+  unsigned int warning_events;   // Transitions into error warning (EWGF)
+  unsigned int passive_events;   // Transitions into error passive (EPVF)
+  unsigned int bus_off_events;   // Transitions into bus-off (BOFF)
+  unsigned int recoveries;       // Bus-off recoveries started by software
+  unsigned int lec_events[8];    // Protocol errors by last error code
+
   void Update() {
     rec = (CAN->ESR & CAN_ESR_REC_Msk) >> CAN_ESR_REC_Pos;
     tec = (CAN->ESR & CAN_ESR_TEC_Msk) >> CAN_ESR_TEC_Pos;
-    lec = (CAN->ESR & CAN_ESR_LEC_Msk) >> CAN_ESR_LEC_Pos;
+    // 7 is written back by the error interrupt once a code is counted
+    if (auto code = (CAN->ESR & CAN_ESR_LEC_Msk) >> CAN_ESR_LEC_Pos;
+        code != 7) {
+      lec = code;
+    }
     boff = (CAN->ESR & CAN_ESR_BOFF_Msk) >> CAN_ESR_BOFF_Pos;
     epvf = (CAN->ESR & CAN_ESR_EPVF_Msk) >> CAN_ESR_EPVF_Pos;
     ewgf = (CAN->ESR & CAN_ESR_EWGF_Msk) >> CAN_ESR_EWGF_Pos;
@@ -127,9 +170,29 @@ struct CANErrorStatistic {
 };
 
 struct CANMessage {
+  static constexpr uint32_t kStandardIdMask = 0x7FF;
+  static constexpr uint32_t kExtendedIdMask = 0x1FFFFFFF;
+
   uint32_t id = 0;
   uint32_t length;
   std::array<uint8_t, 8> data = {0};
+  bool extended = true;  // false: 11-bit standard ID, true: 29-bit extended ID
+  bool remote = false;   // Remote transmission request (no payload)
+  uint32_t timestamp = 0;  // SOF time [bit times] (Config::kTimestamps only)
+
+  /// @brief Identifier part of the TIR/RIR mailbox register (IDE, RTR incl.)
+  [[nodiscard]] constexpr uint32_t EncodeIdentifier() const {
+    uint32_t ir = 0;
+    if (extended) {
+      ir = ((id & kExtendedIdMask) << CAN_TI0R_EXID_Pos) | CAN_TI0R_IDE;
+    } else {
+      ir = (id & kStandardIdMask) << CAN_TI0R_STID_Pos;
+    }
+    if (remote) {
+      ir |= CAN_TI0R_RTR;
+    }
+    return ir;
+  }
 
   constexpr uint32_t EncodeHigh() const {
     return data[4] | (data[5] << 8) | (data[6] << 16) | (data[7] << 24);
@@ -138,6 +201,312 @@ struct CANMessage {
   constexpr uint32_t EncodeLow() const {
     return data[0] | (data[1] << 8) | (data[2] << 16) | (data[3] << 24);
   }
+
+  /// @brief Bus arbitration order (smaller value wins the arbitration)
+  /// @details Arbitration field bits in wire order:
+  ///   standard: ID[10:0] RTR IDE(0)
+  ///   extended: ID[28:18] SRR(1) IDE(1) ID[17:0] RTR
+  [[nodiscard]] constexpr uint32_t ArbitrationKey() const {
+    if (!extended) {
+      return ((id & kStandardIdMask) << 21) | ((remote ? 1 : 0) << 20);
+    }
+
+    auto base = (id >> 18) & kStandardIdMask;
+    auto extension = id & 0x3FFFF;
+    return (base << 21) | (1 << 20) | (1 << 19) | (extension << 1) |
+           (remote ? 1 : 0);
+  }
+};
+
+/// @brief Extends the 16-bit TTCM capture time (TIME in RDTR/TDTR) to 64 bits
+/// @details Samples may arrive slightly out of order (RX FIFOs and TX
+///          completions), so each one is placed within +-2^15 bit times of
+///          where a free running cycle counter expects the bus time to be.
+///          The wrap count therefore survives idle buses until the cycle
+///          counter wraps (2^32 cycles, 107 s at 40 MHz). Without the
+///          counter (cycles_per_bit 0) a frame has to be observed every 2^15
+///          bit times (32 ms at 1 Mbit/s).
+class CANTimestampExtender {
+  uint64_t latest_ = 0;         // [bit times]
+  uint32_t latest_cycles_ = 0;  // Cycle counter when latest_ was observed
+  uint32_t cycles_per_bit_ = 0;
+  bool seeded_ = false;
+
+  [[nodiscard]] uint64_t Expected(uint32_t now_cycles) const {
+    if (cycles_per_bit_ == 0) {
+      return latest_;
+    }
+    return latest_ + (now_cycles - latest_cycles_) / cycles_per_bit_;
+  }
+
+ public:
+  /// @brief The controller (re)joined the bus and its timer restarted
+  /// @details The next sample is placed at or after the time that has
+  ///          elapsed, so the extended time never runs backwards
+  void Restart(uint32_t now_cycles, uint32_t cycles_per_bit) {
+    latest_ = Expected(now_cycles);
+    latest_cycles_ = now_cycles;
+    cycles_per_bit_ = cycles_per_bit;
+    seeded_ = false;
+  }
+
+  uint64_t Extend(uint16_t sample, uint32_t now_cycles) {
+    auto expected = Expected(now_cycles);
+    if (!seeded_) {
+      seeded_ = true;
+      latest_ = expected + static_cast<uint16_t>(
+                               sample - static_cast<uint16_t>(expected));
+      latest_cycles_ = now_cycles;
+      return latest_;
+    }
+
+    auto delta =
+        static_cast<int16_t>(sample - static_cast<uint16_t>(expected));
+    auto time = expected + delta;
+    if (time > latest_) {
+      latest_ = time;
+      latest_cycles_ = now_cycles;
+    }
+    return time;
+  }
+
+  [[nodiscard]] uint64_t Latest() const { return latest_; }
+};
+
+/// @brief Undecoded copy of a receive FIFO mailbox
+struct CANRawFrame {
+  uint32_t rir;
+  uint32_t rdtr;
+  uint32_t rdlr;
+  uint32_t rdhr;
+  uint32_t fifo;
+  uint32_t timestamp;  // Extended TIME (filled by the RX interrupt)
+
+  static CANRawFrame Read(int fifo) {
+    auto& mailbox = CAN->sFIFOMailBox[fifo];
+
+    return {.rir = mailbox.RIR,
+            .rdtr = mailbox.RDTR,
+            .rdlr = mailbox.RDLR,
+            .rdhr = mailbox.RDHR,
+            .fifo = static_cast<uint32_t>(fifo),
+            .timestamp = 0};
+  }
+
+  [[nodiscard]] constexpr uint16_t CaptureTime() const {
+    return (rdtr & CAN_RDT0R_TIME_Msk) >> CAN_RDT0R_TIME_Pos;
+  }
+
+  /// @brief Index of the filter that accepted the frame (RDTR.FMI)
+  [[nodiscard]] constexpr uint32_t FilterMatchIndex() const {
+    return (rdtr & CAN_RDT0R_FMI_Msk) >> CAN_RDT0R_FMI_Pos;
+  }
+
+  [[nodiscard]] constexpr CANMessage Decode() const {
+    bool ide = rir & CAN_RI0R_IDE;
+
+    // EXID in CMSIS covers ID[17:0] only; the 29-bit ID spans STID and EXID
+    auto id = ide ? (rir >> CAN_RI0R_EXID_Pos) & CANMessage::kExtendedIdMask
+                  : (rir >> CAN_RI0R_STID_Pos) & CANMessage::kStandardIdMask;
+
+    auto dlc = (rdtr & CAN_RDT0R_DLC_Msk) >> CAN_RDT0R_DLC_Pos;
+
+    CANMessage msg = {.id = id,
+                      .length = dlc,
+                      .extended = ide,
+                      .remote = (rir & CAN_RI0R_RTR) != 0,
+                      .timestamp = timestamp};
+    if (msg.remote) {
+      return msg;
+    }
+
+    msg.data[0] = (rdlr & 0x000000FF) >> 0;
+    msg.data[1] = (rdlr & 0x0000FF00) >> 8;
+    msg.data[2] = (rdlr & 0x00FF0000) >> 16;
+    msg.data[3] = (rdlr & 0xFF000000) >> 24;
+
+    if (dlc > 4) {
+      msg.data[4] = (rdhr & 0x000000FF) >> 0;
+      msg.data[5] = (rdhr & 0x0000FF00) >> 8;
+      msg.data[6] = (rdhr & 0x00FF0000) >> 16;
+      msg.data[7] = (rdhr & 0xFF000000) >> 24;
+    }
+
+    return msg;
+  }
+};
+
+/// @brief Lock-free single-producer (RX ISR) / single-consumer ring of frames
+/// @details Both RX FIFO interrupts must share one NVIC priority so that they
+///          never preempt each other and act as a single producer.
+template <size_t kDepth, typename Frame = CANRawFrame>
+class CANRxRing {
+  static_assert((kDepth & (kDepth - 1)) == 0, "Depth must be a power of two");
+
+  std::array<Frame, kDepth> frames_ = {};
+  std::atomic<uint32_t> head_ = 0;  // written by the producer only
+  std::atomic<uint32_t> tail_ = 0;  // written by the consumer only
+
+  size_t high_water_ = 0;
+  uint32_t overflow_ = 0;
+
+ public:
+  [[nodiscard]] size_t Size() const {
+    return head_.load(std::memory_order_acquire) -
+           tail_.load(std::memory_order_acquire);
+  }
+  [[nodiscard]] bool Empty() const { return Size() == 0; }
+  [[nodiscard]] size_t HighWater() const { return high_water_; }
+  [[nodiscard]] uint32_t Overflow() const { return overflow_; }
+
+  //* Producer
+  bool Push(Frame const& frame) {
+    auto head = head_.load(std::memory_order_relaxed);
+    auto used = head - tail_.load(std::memory_order_acquire);
+    if (used >= kDepth) {
+      overflow_++;
+      return false;
+    }
+
+    frames_[head & (kDepth - 1)] = frame;
+    head_.store(head + 1, std::memory_order_release);
+
+    if (used + 1 > high_water_) {
+      high_water_ = used + 1;
+    }
+    return true;
+  }
+
+  //* Consumer
+  bool Pop(Frame& frame) {
+    auto tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    frame = frames_[tail & (kDepth - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+};
+
+struct CANRxStatistic {
+  size_t ring_depth;       // Frames waiting for ProcessDeferredRx
+  size_t ring_high_water;  // Maximum of ring_depth since Init
+  uint32_t overflow;       // Frames lost because the ring was full
+};
+
+/// @brief Bounded software TX queue ordered by CAN arbitration priority
+/// @details Frames with the same priority leave in the order they were pushed.
+template <size_t kDepth>
+class CANTxQueue {
+  static_assert(kDepth > 0, "TX queue must have at least one entry");
+
+ public:
+  struct Entry {
+    CANMessage message;
+    uint32_t sequence;
+  };
+
+ private:
+  std::array<Entry, kDepth> heap_ = {};  // binary min-heap
+  size_t size_ = 0;
+  size_t high_water_ = 0;
+  uint32_t sequence_ = 0;
+
+  static constexpr bool Before(Entry const& a, Entry const& b) {
+    auto key_a = a.message.ArbitrationKey();
+    auto key_b = b.message.ArbitrationKey();
+    if (key_a != key_b) {
+      return key_a < key_b;
+    }
+
+    return static_cast<int32_t>(a.sequence - b.sequence) < 0;
+  }
+
+ public:
+  [[nodiscard]] bool Empty() const { return size_ == 0; }
+  [[nodiscard]] bool Full() const { return size_ == kDepth; }
+  [[nodiscard]] size_t Size() const { return size_; }
+  [[nodiscard]] size_t HighWater() const { return high_water_; }
+  [[nodiscard]] Entry const& Top() const { return heap_[0]; }
+
+  /// @brief Issue the sequence number for a frame that bypasses the queue
+  uint32_t NextSequence() { return sequence_++; }
+
+  bool Push(CANMessage const& message) {
+    return Push(Entry{.message = message, .sequence = sequence_++});
+  }
+
+  /// @brief Overwrite a queued frame with the same arbitration key in place
+  /// @return false if there is no such frame
+  bool Replace(CANMessage const& message) {
+    auto key = message.ArbitrationKey();
+    for (size_t i = 0; i < size_; i++) {
+      if (heap_[i].message.ArbitrationKey() == key) {
+        heap_[i].message = message;
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  /// @brief Push keeping the original sequence (used to re-queue a frame)
+  bool Push(Entry const& entry) {
+    if (Full()) {
+      return false;
+    }
+
+    auto i = size_++;
+    while (i > 0) {
+      auto parent = (i - 1) / 2;
+      if (!Before(entry, heap_[parent])) {
+        break;
+      }
+      heap_[i] = heap_[parent];
+      i = parent;
+    }
+    heap_[i] = entry;
+
+    if (size_ > high_water_) {
+      high_water_ = size_;
+    }
+    return true;
+  }
+
+  Entry Pop() {
+    auto top = heap_[0];
+    auto last = heap_[--size_];
+
+    size_t i = 0;
+    while (true) {
+      auto child = 2 * i + 1;
+      if (child >= size_) {
+        break;
+      }
+      if (child + 1 < size_ && Before(heap_[child + 1], heap_[child])) {
+        child++;
+      }
+      if (!Before(heap_[child], last)) {
+        break;
+      }
+      heap_[i] = heap_[child];
+      i = child;
+    }
+    heap_[i] = last;
+
+    return top;
+  }
+};
+
+struct CANTxStatistic {
+  size_t queue_depth;       // Frames waiting for a mailbox
+  size_t queue_high_water;  // Maximum of queue_depth since Init
+  uint32_t dropped;         // Frames rejected because the queue was full
+  uint32_t preempted;       // Mailboxes aborted for a higher priority frame
+  uint32_t failed;          // Frames completed without TXOK
+  uint32_t replaced;        // Stale frames overwritten by SendLatest
 };
 
 template <int kMailboxId>
@@ -155,7 +524,7 @@ class Mailbox {
 
   void RequestAbort() {
     auto abrq_pos = 7 + 8 * kMailboxId;
-    CAN->TSR |= (1 << abrq_pos);
+    CAN->TSR = (1 << abrq_pos);  // |= would clear the rc_w1 RQCP/TXOK bits
 
     while ((CAN->TSR & (1 << abrq_pos)) != 0)
       ;
@@ -190,8 +559,7 @@ class Mailbox {
   }
 
   void Send(CANMessage const& message) {
-    mailbox.TIR = (message.id << CAN_TI0R_EXID_Pos);
-    mailbox.TIR |= CAN_TI0R_IDE;
+    mailbox.TIR = message.EncodeIdentifier();
     mailbox.TDTR = message.length;
     mailbox.TDLR = message.EncodeLow();
     if (message.data.size() > 4) {
@@ -231,8 +599,94 @@ concept CANHandler = requires {
   {T::HandleError()}->std::same_as<void>;
 };
 
-template <CANHandler Handler>
+/// @brief Optional CANHandler extension, called for every frame sent (TXOK)
+template <typename T>
+concept CANTxCompleteHandler = requires {
+  {T::HandleTxComplete(std::declval<CANMessage>())}->std::same_as<void>;
+};
+
+/// @brief Operating mode (RM0316 "Test mode": BTR.LBKM / BTR.SILM)
+enum class CANMode {
+  kNormal,
+  kLoopback,        // TX frames are received back; still driven onto the bus
+  kSilent,          // Listen only: never drives CAN_TX (no ACK, no errors)
+  kSilentLoopback,  // Self-test without touching the bus
+};
+
+/// @brief How the controller leaves the bus-off state
+enum class CANBusOffRecovery {
+  /// Hardware rejoins after 128 x 11 recessive bits (MCR.ABOM)
+  kAutomatic,
+  /// Stays off until ProcessBusOffRecovery() restarts it after a backoff
+  /// that doubles with every bus-off until a frame is sent successfully
+  kManaged,
+};
+
+template <typename T>
+concept CANConfigLike = requires {
+  {T::kTxQueueDepth}->std::convertible_to<size_t>;
+  {T::kRxRingDepth}->std::convertible_to<size_t>;
+  {T::kMaxRxFramesPerIrq}->std::convertible_to<size_t>;
+  {T::kSamplePoint}->std::convertible_to<float>;
+  {T::kSamplePointTolerance}->std::convertible_to<float>;
+  {T::kTimestamps}->std::convertible_to<bool>;
+  {T::kBusOffRecovery}->std::convertible_to<CANBusOffRecovery>;
+  {T::kBusOffBackoffMinMs}->std::convertible_to<uint32_t>;
+  {T::kBusOffBackoffMaxMs}->std::convertible_to<uint32_t>;
+  requires CANFiltersLike<typename T::Filters>;
+};
+
+struct DefaultConfig {
+  static constexpr size_t kTxQueueDepth = 32;
+
+  /// 0: HandleRx is called from the RX interrupt.
+  /// N: the RX interrupt only copies frames into an N-deep ring and HandleRx
+  ///    is called from ProcessDeferredRx (N must be a power of two).
+  static constexpr size_t kRxRingDepth = 0;
+
+  /// Frames drained from one RX FIFO per interrupt entry before yielding
+  static constexpr size_t kMaxRxFramesPerIrq = 8;
+
+  /// Target sample point (ratio of the bit time) and the accepted deviation
+  static constexpr float kSamplePoint = 0.875f;
+  static constexpr float kSamplePointTolerance = 0.05f;
+
+  /// Enables time triggered communication mode; CANMessage::timestamp then
+  /// carries the SOF time of RX frames and of completed TX frames
+  /// (Handler::HandleTxComplete) in bit times
+  static constexpr bool kTimestamps = false;
+
+  /// Bus-off handling; the backoff bounds only apply to kManaged
+  static constexpr CANBusOffRecovery kBusOffRecovery =
+      CANBusOffRecovery::kAutomatic;
+  static constexpr uint32_t kBusOffBackoffMinMs = 10;
+  static constexpr uint32_t kBusOffBackoffMaxMs = 1000;
+
+  /// Hardware acceptance filters, e.g.
+  ///   CANFilters<CANFilterRule::Standard(0x100),
+  ///              CANFilterRule::ExtendedRange(0x1000, 0x1FFFFF00, 1)>
+  /// or, to bind a callback to each filter,
+  ///   CANRouter<CANRoute<CANFilterRule::Standard(0x100), &OnSetpoint>, ...>
+  using Filters = CANFilters<CANFilterRule::AcceptAll()>;
+};
+static_assert(CANConfigLike<DefaultConfig>);
+
+template <CANHandler Handler, CANConfigLike Config = DefaultConfig>
 class BaremetalCAN {
+  using TxQueue = CANTxQueue<Config::kTxQueueDepth>;
+
+  static constexpr bool kDeferredRx = Config::kRxRingDepth != 0;
+  static constexpr bool kManagedRecovery =
+      Config::kBusOffRecovery == CANBusOffRecovery::kManaged;
+  static_assert(Config::kBusOffBackoffMinMs <= Config::kBusOffBackoffMaxMs);
+
+  struct TxSlot {
+    typename TxQueue::Entry entry;
+    bool busy;
+    bool aborting;
+    bool superseded;  // aborted by SendLatest: dropped instead of re-queued
+  };
+
   static inline void Reset() {
     CAN->MCR |= CAN_MCR_RESET;
     while (CAN->MCR & CAN_MCR_RESET)
@@ -255,40 +709,53 @@ class BaremetalCAN {
     CAN->MCR &= ~CAN_MCR_INRQ;
     while ((CAN->MSR & CAN_MSR_INAK) != 0)
       ;
+
+    if constexpr (Config::kTimestamps) {
+      CriticalSection lock;
+      time_extender_.Restart(DWT->CYCCNT, CyclesPerBit());
+    }
+  }
+
+  /// @brief Bit time in CPU cycles (DWT CYCCNT) of the current BTR
+  static inline uint32_t CyclesPerBit() {
+    auto btr = CAN->BTR;
+    auto brp = ((btr & CAN_BTR_BRP_Msk) >> CAN_BTR_BRP_Pos) + 1;
+    auto ts1 = ((btr & CAN_BTR_TS1_Msk) >> CAN_BTR_TS1_Pos) + 1;
+    auto ts2 = ((btr & CAN_BTR_TS2_Msk) >> CAN_BTR_TS2_Pos) + 1;
+    return ahb_per_apb1_ * brp * (1 + ts1 + ts2);
   }
 
-  template <rcc::RCCConfigLike kRcc, int kBaudrate>
+  template <rcc::RCCConfigLike kRcc, int kBaudrate, CANMode kMode>
   static inline void InitCAN_Master() {
     Reset();
     ExitSleepMode();
     RequestInitializationMode();
 
     // Config
-    CAN->MCR &= ~CAN_MCR_TTCM;  // Disable Time Trigger Communication Mode
-    CAN->MCR &= ~CAN_MCR_ABOM;  // Disable Automatic Bus-Off Management
+    if constexpr (Config::kTimestamps) {
+      CAN->MCR |= CAN_MCR_TTCM;  // Enable Time Trigger Communication Mode
+
+      // The cycle counter carries the wrap count over idle buses
+      CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+      DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+      ahb_per_apb1_ = kRcc::GetAHBClock() / kRcc::GetAPB1Clock();
+    } else {
+      CAN->MCR &= ~CAN_MCR_TTCM;  // Disable Time Trigger Communication Mode
+    }
+    if constexpr (kManagedRecovery) {
+      CAN->MCR &= ~CAN_MCR_ABOM;  // Disable Automatic Bus-Off Management
+    } else {
+      CAN->MCR |= CAN_MCR_ABOM;  // Enable Automatic Bus-Off Management
+    }
     CAN->MCR &= ~CAN_MCR_AWUM;  // Disable Automatic Wakeup Mode
     CAN->MCR &= ~CAN_MCR_NART;  // ENable Automatic Retransmission
     CAN->MCR &= ~CAN_MCR_RFLM;  // Disable Receive FIFO Locked Mode
     CAN->MCR &= ~CAN_MCR_TXFP;  // Disable Transmit FIFO Priority
 
-    // Timing
-    constexpr auto timing =
-        CANTiming::FindAppropriateTiming<kRcc::GetAPB1Clock()>(kBaudrate);
-    uint32_t btr = 0;
-    btr |= ((timing.brp - 1) << CAN_BTR_BRP_Pos);
-    btr |= ((timing.ts1 - 1) << CAN_BTR_TS1_Pos);
-    btr |= ((timing.ts2 - 1) << CAN_BTR_TS2_Pos);
-    btr |= (1 << CAN_BTR_SJW_Pos);
-    CAN->BTR = btr;
+    CAN->BTR = BitTiming<kRcc, kBaudrate, kMode>();
   }
 
-  static inline void InitCAN_Filter() {
-    CAN->FMR |= CAN_FMR_FINIT;  // Enter Filter Initialization Mode
-
-    MaskFilter{.id = 0x0, .mask = 0x0}.Configure<0>();
-
-    CAN->FMR &= ~CAN_FMR_FINIT;  // Leave Filter Initialization Mode
-  }
+  static inline void InitCAN_Filter() { Config::Filters::Apply(); }
 
   static auto GetFreeMailbox() {
     auto tme0 = (CAN->TSR & CAN_TSR_TME0) >> CAN_TSR_TME0_Pos;
@@ -307,20 +774,215 @@ class BaremetalCAN {
     return -1;
   }
 
+  /// @brief Lowest free mailbox that keeps FIFO order against the in-flight
+  ///        frames of the same priority (the lower mailbox number wins ties)
+  static int GetFreeMailboxFor(CANMessage const& message) {
+    auto key = message.ArbitrationKey();
+    auto tsr = CAN->TSR;
+
+    int first = 0;
+    for (int i = 0; i < 3; i++) {
+      auto const& slot = tx_slots_[i];
+      if (!slot.busy || slot.entry.message.ArbitrationKey() != key) {
+        continue;
+      }
+      if (slot.aborting) {
+        return -1;  // Wait until the abort resolves (re-queue or drop)
+      }
+      first = i + 1;
+    }
+
+    for (int i = first; i < 3; i++) {
+      if (tsr & (CAN_TSR_TME0 << i)) {
+        return i;
+      }
+    }
+
+    return -1;
+  }
+
+  /// @brief Routes by filter match index if Config::Filters is a CANRouter
+  static void DispatchRx(CANRawFrame const& frame) {
+    auto msg = frame.Decode();
+
+    if constexpr (CANRouterLike<typename Config::Filters>) {
+      if (Config::Filters::Dispatch(frame.fifo, frame.FilterMatchIndex(),
+                                    msg)) {
+        return;
+      }
+    }
+
+    Handler::HandleRx(frame.fifo, msg);
+  }
+
+  static void LoadMailbox(int index, typename TxQueue::Entry const& entry) {
+    tx_slots_[index] = {
+        .entry = entry, .busy = true, .aborting = false, .superseded = false};
+
+    switch (index) {
+      case 0:
+        mailbox0_.Send(entry.message);
+        break;
+      case 1:
+        mailbox1_.Send(entry.message);
+        break;
+      case 2:
+        mailbox2_.Send(entry.message);
+        break;
+    }
+  }
+
+  /// @brief Collect finished mailboxes (re-queues frames that were aborted)
+  static void ProcessTxCompletion() {
+    for (int i = 0; i < 3; i++) {
+      const uint32_t rqcp = CAN_TSR_RQCP0 << (8 * i);
+      const uint32_t txok = CAN_TSR_TXOK0 << (8 * i);
+
+      auto tsr = CAN->TSR;
+      if ((tsr & rqcp) == 0) {
+        continue;
+      }
+      CAN->TSR = rqcp;  // rc_w1: also clears TXOK, ALST and TERR
+
+      auto& slot = tx_slots_[i];
+      if (!slot.busy) {
+        continue;
+      }
+      slot.busy = false;
+
+      if (tsr & txok) {
+        if constexpr (kManagedRecovery) {
+          bus_off_backoff_ms_ = Config::kBusOffBackoffMinMs;
+        }
+        if constexpr (CANTxCompleteHandler<Handler>) {
+          auto message = slot.entry.message;
+          if constexpr (Config::kTimestamps) {
+            auto tdtr = CAN->sTxMailBox[i].TDTR;
+            message.timestamp = time_extender_.Extend(
+                (tdtr & CAN_TDT0R_TIME_Msk) >> CAN_TDT0R_TIME_Pos,
+                DWT->CYCCNT);
+          }
+          Handler::HandleTxComplete(message);
+        }
+        continue;
+      }
+
+      if (slot.superseded) {
+        continue;
+      }
+
+      if (slot.aborting) {
+        if (!tx_queue_.Push(slot.entry)) {
+          tx_statistic_.dropped++;
+        }
+      } else {
+        tx_statistic_.failed++;
+      }
+    }
+  }
+
+  /// @brief Move queued frames into free mailboxes, or abort a mailbox that
+  ///        holds a lower priority frame than the head of the queue
+  static void RefillTxMailboxes() {
+    while (!tx_queue_.Empty()) {
+      auto index = GetFreeMailboxFor(tx_queue_.Top().message);
+      if (index < 0) {
+        break;
+      }
+
+      LoadMailbox(index, tx_queue_.Pop());
+    }
+
+    if (tx_queue_.Empty()) {
+      return;
+    }
+
+    auto head_key = tx_queue_.Top().message.ArbitrationKey();
+    int victim = -1;
+    for (int i = 0; i < 3; i++) {
+      auto const& slot = tx_slots_[i];
+      if (!slot.busy || slot.aborting) {
+        continue;
+      }
+
+      auto key = slot.entry.message.ArbitrationKey();
+      if (key > head_key &&
+          (victim < 0 ||
+           key > tx_slots_[victim].entry.message.ArbitrationKey())) {
+        victim = i;
+      }
+    }
+
+    if (victim >= 0) {
+      tx_slots_[victim].aborting = true;
+      CAN->TSR = CAN_TSR_ABRQ0 << (8 * victim);  // Completes via RQCP
+      tx_statistic_.preempted++;
+    }
+  }
+
  public:
+  using Message = CANMessage;
+
+  /// @brief BTR image (bit timing and test mode), e.g. for Restart()
+  template <rcc::RCCConfigLike kRcc, int kBaudrate,
+            CANMode kMode = CANMode::kNormal>
+  static consteval uint32_t BitTiming() {
+    constexpr auto timing =
+        CANTiming::FindAppropriateTiming<kRcc::GetAPB1Clock()>(
+            kBaudrate, Config::kSamplePoint);
+    static_assert(timing.exact, "No exact CAN bit timing for this APB1 clock");
+
+    constexpr auto sample_point_error =
+        timing.SamplePoint() - Config::kSamplePoint;
+    static_assert(-Config::kSamplePointTolerance <= sample_point_error &&
+                      sample_point_error <= Config::kSamplePointTolerance,
+                  "CAN sample point is too far from Config::kSamplePoint");
+
+    uint32_t btr = 0;
+    btr |= ((timing.brp - 1) << CAN_BTR_BRP_Pos);
+    btr |= ((timing.ts1 - 1) << CAN_BTR_TS1_Pos);
+    btr |= ((timing.ts2 - 1) << CAN_BTR_TS2_Pos);
+    btr |= ((timing.sjw - 1) << CAN_BTR_SJW_Pos);
+    if constexpr (kMode == CANMode::kLoopback ||
+                  kMode == CANMode::kSilentLoopback) {
+      btr |= CAN_BTR_LBKM;
+    }
+    if constexpr (kMode == CANMode::kSilent ||
+                  kMode == CANMode::kSilentLoopback) {
+      btr |= CAN_BTR_SILM;
+    }
+    return btr;
+  }
+
   static inline void Start() { LeaveInitializationMode(); }
 
-  template <rcc::RCCConfigLike kRcc, int kBaudrate>
+  /// @brief Leave the bus (initialization mode); queued frames stay queued
+  static inline void Stop() { RequestInitializationMode(); }
+
+  /// @brief Rejoin the bus with another bit timing / mode (see BitTiming)
+  /// @note  Init must have run once
+  static inline void Restart(uint32_t btr) {
+    RequestInitializationMode();
+    CAN->BTR = btr;
+    LeaveInitializationMode();
+  }
+
+  template <rcc::RCCConfigLike kRcc, int kBaudrate,
+            CANMode kMode = CANMode::kNormal>
   static inline void Init() {
     RCC->APB1ENR |= RCC_APB1ENR_CANEN;
 
-    InitCAN_Master<kRcc, kBaudrate>();
+    InitCAN_Master<kRcc, kBaudrate, kMode>();
     InitCAN_Filter();
     Start();
 
     // Interrupt
     CAN->IER |= CAN_IER_FMPIE0;  // FIFO 0 Message Pending Interrupt Enable
-    CAN->IER |= CAN_IER_FMPIE1;  // FIFO 0 Message Pending Interrupt Enable
+    CAN->IER |= CAN_IER_FFIE0;   // FIFO 0 Full Interrupt Enable
+    CAN->IER |= CAN_IER_FOVIE0;  // FIFO 0 Overrun Interrupt Enable
+    CAN->IER |= CAN_IER_FMPIE1;  // FIFO 1 Message Pending Interrupt Enable
+    CAN->IER |= CAN_IER_FFIE1;   // FIFO 1 Full Interrupt Enable
+    CAN->IER |= CAN_IER_FOVIE1;  // FIFO 1 Overrun Interrupt Enable
 
     NVIC_SetPriority(CAN_RX0_IRQn,
                      NVIC_EncodePriority(NVIC_GetPriorityGrouping(), 0, 0));
@@ -335,6 +997,29 @@ class BaremetalCAN {
     stm32f3::ram_vector::ram_vector[16 + CAN_RX1_IRQn] = []() {
       ISR_ProcessRxFIFO(1);
     };
+
+    CAN->IER |= CAN_IER_TMEIE;  // Transmit Mailbox Empty Interrupt Enable
+
+    NVIC_SetPriority(CAN_TX_IRQn,
+                     NVIC_EncodePriority(NVIC_GetPriorityGrouping(), 0, 0));
+    NVIC_EnableIRQ(CAN_TX_IRQn);
+    stm32f3::ram_vector::ram_vector[16 + CAN_TX_IRQn] = []() {
+      ISR_ProcessTx();
+    };
+
+    CAN->ESR = CAN_ESR_LEC;     // LEC = 7: only hardware updates are new
+    CAN->IER |= CAN_IER_EWGIE;  // Error Warning Interrupt Enable
+    CAN->IER |= CAN_IER_EPVIE;  // Error Passive Interrupt Enable
+    CAN->IER |= CAN_IER_BOFIE;  // Bus-Off Interrupt Enable
+    CAN->IER |= CAN_IER_LECIE;  // Last Error Code Interrupt Enable
+    CAN->IER |= CAN_IER_ERRIE;  // Error Interrupt Enable
+
+    NVIC_SetPriority(CAN_SCE_IRQn,
+                     NVIC_EncodePriority(NVIC_GetPriorityGrouping(), 0, 0));
+    NVIC_EnableIRQ(CAN_SCE_IRQn);
+    stm32f3::ram_vector::ram_vector[16 + CAN_SCE_IRQn] = []() {
+      ISR_ProcessError();
+    };
   }
 
   static inline auto GetErrorStatistic() {
@@ -353,52 +1038,217 @@ class BaremetalCAN {
     }
   }
 
-  static inline auto Send(const CANMessage& message) {
-    switch (GetFreeMailbox()) {
-      case 0:
-        mailbox0_.Send(message);
-        return true;
-      case 1:
-        mailbox1_.Send(message);
-        return true;
-      case 2:
-        mailbox2_.Send(message);
+  static inline auto GetTxStatistic() {
+    CriticalSection lock;
+
+    CANTxStatistic statistic = tx_statistic_;
+    statistic.queue_depth = tx_queue_.Size();
+    statistic.queue_high_water = tx_queue_.HighWater();
+    return statistic;
+  }
+
+  /// @brief Hand a frame to a mailbox, or queue it until one becomes free
+  /// @return false if the TX queue is full and the frame was dropped
+  static inline bool Send(const CANMessage& message) {
+    CriticalSection lock;
+
+    ProcessTxCompletion();
+
+    if (tx_queue_.Empty()) {
+      auto index = GetFreeMailboxFor(message);
+      if (index >= 0) {
+        LoadMailbox(index, {.message = message,
+                            .sequence = tx_queue_.NextSequence()});
         return true;
-      default:
-        return false;
+      }
+    }
+
+    if (!tx_queue_.Push(message)) {
+      tx_statistic_.dropped++;
+      return false;
     }
+
+    RefillTxMailboxes();
+    return true;
   }
 
-  static inline void ISR_ProcessRxFIFO(int i) {
-    const auto fr_from = i == 0 ? CAN_RF0R_RFOM0 : CAN_RF1R_RFOM1;
-    auto& frr = i == 0 ? CAN->RF0R : CAN->RF1R;
+  /// @brief Send with latest-value semantics: a frame with the same
+  ///        identifier that is still waiting is replaced by this one
+  /// @details A queued frame is overwritten in place. A frame that is
+  ///          pending in a mailbox is aborted and dropped, and this one takes
+  ///          its turn; if the old frame already won arbitration it is sent
+  ///          and this one follows.
+  static inline bool SendLatest(const CANMessage& message) {
+    CriticalSection lock;
+
+    ProcessTxCompletion();
+
+    if (tx_queue_.Replace(message)) {
+      tx_statistic_.replaced++;
+      return true;
+    }
+
+    auto key = message.ArbitrationKey();
+    for (int i = 0; i < 3; i++) {
+      auto& slot = tx_slots_[i];
+      if (!slot.busy || slot.entry.message.ArbitrationKey() != key) {
+        continue;
+      }
+
+      if (!slot.superseded) {
+        slot.superseded = true;
+        tx_statistic_.replaced++;
+      }
+      if (!slot.aborting) {
+        slot.aborting = true;
+        CAN->TSR = CAN_TSR_ABRQ0 << (8 * i);  // Completes via RQCP
+      }
+    }
 
-    auto& fifo = CAN->sFIFOMailBox[i];
+    if (!tx_queue_.Push(message)) {
+      tx_statistic_.dropped++;
+      return false;
+    }
 
-    auto ide = (fifo.RIR & CAN_RI0R_IDE) >> CAN_RI0R_IDE_Pos;
+    RefillTxMailboxes();
+    return true;
+  }
 
-    auto id =
-        ide ? (fifo.RIR >> CAN_RI0R_EXID_Pos) : (fifo.RIR >> CAN_RI0R_STID_Pos);
+  static inline void ISR_ProcessTx() {
+    CriticalSection lock;
 
-    auto dlc = (fifo.RDTR & CAN_RDT0R_DLC_Msk) >> CAN_RDT0R_DLC_Pos;
+    ProcessTxCompletion();
+    RefillTxMailboxes();
+  }
 
-    CANMessage msg = {.id = id, .length = dlc};
+  /// @brief Counts error state transitions and protocol errors, then calls
+  ///        Handler::HandleError
+  static inline void ISR_ProcessError() {
+    CAN->MSR = CAN_MSR_ERRI;  // rc_w1
 
-    msg.data[0] = (fifo.RDLR & 0x000000FF) >> 0;
-    msg.data[1] = (fifo.RDLR & 0x0000FF00) >> 8;
-    msg.data[2] = (fifo.RDLR & 0x00FF0000) >> 16;
-    msg.data[3] = (fifo.RDLR & 0xFF000000) >> 24;
+    auto esr = CAN->ESR;
+    auto state = esr & (CAN_ESR_EWGF | CAN_ESR_EPVF | CAN_ESR_BOFF);
+    auto rising = state & ~error_state_;
+    error_state_ = state;
 
-    if (dlc > 4) {
-      msg.data[4] = (fifo.RDHR & 0x000000FF) >> 0;
-      msg.data[5] = (fifo.RDHR & 0x0000FF00) >> 8;
-      msg.data[6] = (fifo.RDHR & 0x00FF0000) >> 16;
-      msg.data[7] = (fifo.RDHR & 0xFF000000) >> 24;
+    if (rising & CAN_ESR_EWGF) {
+      error_statistic_.warning_events++;
+    }
+    if (rising & CAN_ESR_EPVF) {
+      error_statistic_.passive_events++;
+    }
+    if (rising & CAN_ESR_BOFF) {
+      error_statistic_.bus_off_events++;
+      if constexpr (kManagedRecovery) {
+        bus_off_pending_ = true;
+      }
     }
 
-    Handler::HandleRx(i, msg);
+    auto lec = (esr & CAN_ESR_LEC_Msk) >> CAN_ESR_LEC_Pos;
+    if (lec != 0 && lec != 7) {
+      error_statistic_.lec = lec;
+      error_statistic_.lec_events[lec]++;
+      CAN->ESR = CAN_ESR_LEC;  // Mark as seen (the other fields are ro)
+    }
+
+    Handler::HandleError();
+  }
+
+  /// @brief Restarts a bus-off controller once the backoff has elapsed
+  /// @param now_ms Free running millisecond clock (wrap-around safe)
+  /// @return true if a recovery was started by this call
+  static inline bool ProcessBusOffRecovery(uint32_t now_ms) {
+    static_assert(kManagedRecovery,
+                  "Config::kBusOffRecovery is not CANBusOffRecovery::kManaged");
+
+    if (!bus_off_pending_) {
+      return false;
+    }
+
+    // The ISR has no clock, so the backoff starts at the first poll
+    if (!bus_off_timing_) {
+      bus_off_timing_ = true;
+      bus_off_since_ms_ = now_ms;
+      return false;
+    }
+    if (now_ms - bus_off_since_ms_ < bus_off_backoff_ms_) {
+      return false;
+    }
+
+    {
+      CriticalSection lock;
+      bus_off_pending_ = false;
+      bus_off_timing_ = false;
+      bus_off_backoff_ms_ =
+          std::min(bus_off_backoff_ms_ * 2, Config::kBusOffBackoffMaxMs);
+      error_statistic_.recoveries++;
+    }
+
+    // Leaving initialization mode starts the 128 x 11 recessive bit sequence
+    RequestInitializationMode();
+    LeaveInitializationMode();
+    return true;
+  }
+
+  static inline auto GetRxStatistic() {
+    return CANRxStatistic{.ring_depth = rx_ring_.Size(),
+                          .ring_high_water = rx_ring_.HighWater(),
+                          .overflow = rx_ring_.Overflow()};
+  }
 
-    frr |= fr_from;  // Release FIFO 0
+  /// @brief Decode and dispatch frames queued by the RX interrupt
+  /// @param max_frames Upper bound of frames handled by this call
+  /// @return Number of frames handled
+  static inline size_t ProcessDeferredRx(size_t max_frames = SIZE_MAX) {
+    static_assert(kDeferredRx, "Config::kRxRingDepth is 0");
+
+    size_t processed = 0;
+    CANRawFrame frame;
+    while (processed < max_frames && rx_ring_.Pop(frame)) {
+      DispatchRx(frame);
+      processed++;
+    }
+
+    return processed;
+  }
+
+  /// @brief Handles FIFO i until it is empty (or kMaxRxFramesPerIrq frames)
+  static inline void ISR_ProcessRxFIFO(int i) {
+    // RFxR bits share their positions between FIFO 0 and FIFO 1
+    auto& frr = i == 0 ? CAN->RF0R : CAN->RF1R;
+
+    auto status = frr;
+    if (status & CAN_RF0R_FOVR0) {
+      error_statistic_.fifo_overrun[i]++;
+      frr = CAN_RF0R_FOVR0;  // rc_w1
+    }
+    if (status & CAN_RF0R_FULL0) {
+      error_statistic_.fifo_full[i]++;
+      frr = CAN_RF0R_FULL0;  // rc_w1
+    }
+
+    for (size_t n = 0; n < Config::kMaxRxFramesPerIrq; n++) {
+      if ((frr & CAN_RF0R_FMP0_Msk) == 0) {
+        break;
+      }
+
+      auto frame = CANRawFrame::Read(i);
+      if constexpr (Config::kTimestamps) {
+        frame.timestamp =
+            time_extender_.Extend(frame.CaptureTime(), DWT->CYCCNT);
+      }
+
+      if constexpr (kDeferredRx) {
+        rx_ring_.Push(frame);
+      } else {
+        DispatchRx(frame);
+      }
+
+      // Release the output mailbox (a plain write keeps FULL/FOVR intact)
+      frr = CAN_RF0R_RFOM0;
+      while (frr & CAN_RF0R_RFOM0)
+        ;
+    }
   }
 
  private:
@@ -406,6 +1256,22 @@ class BaremetalCAN {
   static inline Mailbox<0> mailbox0_;
   static inline Mailbox<1> mailbox1_;
   static inline Mailbox<2> mailbox2_;
+
+  static inline TxQueue tx_queue_;
+  static inline std::array<TxSlot, 3> tx_slots_ = {};
+  static inline CANTxStatistic tx_statistic_ = {};
+
+  static inline CANRxRing<Config::kRxRingDepth> rx_ring_;
+
+  static inline CANTimestampExtender time_extender_;
+  static inline uint32_t ahb_per_apb1_ = 1;  // CYCCNT counts AHB cycles
+
+  static inline uint32_t error_state_ = 0;  // ESR EWGF/EPVF/BOFF at last IRQ
+
+  static inline volatile bool bus_off_pending_ = false;
+  static inline bool bus_off_timing_ = false;
+  static inline uint32_t bus_off_since_ms_ = 0;
+  static inline uint32_t bus_off_backoff_ms_ = Config::kBusOffBackoffMinMs;
 };
 
 }  // namespace stm32f3::can
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+//* CAN schedulability analysis
+//  Worst-case response times of a fixed-priority periodic message set on one
+//  bus (Davis, Burns, Bril, Lukkien: "Controller Area Network (CAN)
+//  schedulability analysis: Refuted, revisited and revised", 2007).
+//  Only depends on the standard library, so a message table can also be
+//  analysed on the host (tools/can_schedule_report).
+
+namespace stm32f3::can {
+struct CANMessage;
+
+static constexpr uint32_t kAutoOffset = 0xFFFFFFFF;
+
+/// @brief A periodic frame: one row of a CANScheduler table, or traffic that
+///        other nodes put on the bus (CANTraffic)
+struct CANPeriodic {
+  uint32_t id;
+  bool extended = false;
+  uint8_t length = 8;
+  uint32_t period_ms;
+  uint32_t offset_ms = kAutoOffset;  // Release time within the period
+  uint32_t jitter_us = 0;            // Queuing jitter (release uncertainty)
+
+  /// Called right before each release to fill the payload; nullptr sends
+  /// the data last given to CANScheduler::Update
+  void (*fill)(CANMessage& message) = nullptr;
+
+  /// @brief Frame length including the intermission, without stuff bits
+  [[nodiscard]] constexpr uint32_t NominalBits() const {
+    return (extended ? 67 : 47) + 8 * length;
+  }
+
+  /// @brief Frame length including the intermission, with the maximum number
+  ///        of stuff bits
+  [[nodiscard]] constexpr uint32_t WorstCaseBits() const {
+    uint32_t stuffed = (extended ? 54 : 34) + 8 * length;  // SOF .. CRC
+    return stuffed + 13 + (stuffed - 1) / 4;
+  }
+
+  /// @brief Lower is higher priority (wire order of the arbitration field)
+  [[nodiscard]] constexpr uint32_t Priority() const {
+    if (!extended) {
+      return (id & 0x7FF) << 21;
+    }
+    return (((id >> 18) & 0x7FF) << 21) | (1 << 20) | ((id & 0x3FFFF) << 1);
+  }
+};
+
+/// @brief Exact on-wire length of one frame, including the stuff bits, the
+///        CRC delimiter, ACK, EOF and intermission (what WorstCaseBits bounds)
+/// @param data `length` bytes (ignored for remote frames)
+constexpr uint32_t CANFrameBits(uint32_t id, bool extended, bool remote,
+                                uint8_t length, uint8_t const* data) {
+  uint32_t bits = 0;
+  uint32_t crc = 0;  // CRC-15, polynomial 0x4599
+  int last = -1;
+  int run = 0;
+
+  // Feeds SOF .. data through the CRC, and SOF .. CRC through the stuffer
+  auto push = [&](uint32_t value, int count, bool crc_input) {
+    for (int i = count - 1; i >= 0; i--) {
+      int bit = (value >> i) & 1;
+      if (crc_input) {
+        bool invert = bit ^ ((crc >> 14) & 1);
+        crc = (crc << 1) & 0x7FFF;
+        if (invert) {
+          crc ^= 0x4599;
+        }
+      }
+
+      bits++;
+      run = bit == last ? run + 1 : 1;
+      last = bit;
+      if (run == 5) {  // Stuff bit of the opposite level starts a new run
+        bits++;
+        last = !bit;
+        run = 1;
+      }
+    }
+  };
+
+  push(0, 1, true);  // SOF
+  if (!extended) {
+    push(id & 0x7FF, 11, true);
+    push(remote, 1, true);  // RTR
+    push(0, 2, true);       // IDE, r0
+  } else {
+    push((id >> 18) & 0x7FF, 11, true);
+    push(0b11, 2, true);  // SRR, IDE
+    push(id & 0x3FFFF, 18, true);
+    push(remote, 1, true);  // RTR
+    push(0, 2, true);       // r1, r0
+  }
+  push(length & 0xF, 4, true);
+  if (!remote) {
+    for (uint32_t i = 0; i < std::min<uint32_t>(length, 8); i++) {
+      push(data[i], 8, true);
+    }
+  }
+  push(crc, 15, false);
+
+  return bits + 13;
+}
+
+/// @brief Periodic frames sent by other nodes (interference only)
+template <CANPeriodic... kEntries>
+struct CANTraffic {
+  static constexpr std::array<CANPeriodic, sizeof...(kEntries)> kTable = {
+      kEntries...};
+};
+
+struct CANResponseTime {
+  CANPeriodic message;
+  bool local;     // Sent by this node
+  bool received;  // Accepted by this node's filters
+
+  uint32_t frame_bits;     // C: worst-case stuffed length
+  uint32_t blocking_bits;  // B: longest lower priority frame
+  uint64_t response_bits;  // R: worst-case response time
+  uint64_t deadline_bits;  // D: = period
+  bool schedulable;
+};
+
+template <size_t N>
+struct CANScheduleAnalysis {
+  uint32_t bitrate;
+  std::array<CANResponseTime, N> messages;  // Highest priority first
+
+  uint64_t utilization_ppm;   // Worst-case bus load [1e-6]
+  uint64_t rx_frames_per_ks;  // Frames accepted by the filters [/1000 s]
+  bool unique;                // No identifier is used twice
+  bool schedulable;
+
+  static constexpr uint64_t BitsToUs(uint64_t bits, uint32_t bitrate) {
+    return (bits * 1000000 + bitrate - 1) / bitrate;
+  }
+  static constexpr uint64_t kUnbounded = UINT64_MAX;
+};
+
+namespace schedule_analysis {
+static constexpr uint64_t kMaxInstances = 1024;  // Per busy period
+
+constexpr uint64_t DivCeil(uint64_t a, uint64_t b) { return (a + b - 1) / b; }
+
+struct Timing {
+  uint64_t c;  // Frame [bits]
+  uint64_t t;  // Period [bits]
+  uint64_t j;  // Jitter [bits]
+  uint32_t priority;
+};
+}  // namespace schedule_analysis
+
+/// @brief Response time analysis of a message set on one bus
+/// @param unknown_blocking Also assume that frames outside the set (e.g. of
+///        nodes that are not described) can block for one maximum length
+///        extended frame
+template <size_t N, typename Accepts>
+consteval CANScheduleAnalysis<N> AnalyzeCANSchedule(
+    std::array<CANPeriodic, N> const& messages, size_t local_count,
+    uint32_t bitrate, Accepts accepts, bool unknown_blocking = true) {
+  using schedule_analysis::DivCeil;
+  using schedule_analysis::Timing;
+
+  CANScheduleAnalysis<N> result = {};
+  result.bitrate = bitrate;
+  result.unique = true;
+  result.schedulable = true;
+
+  std::array<size_t, N> order = {};
+  for (size_t i = 0; i < N; i++) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return messages[a].Priority() < messages[b].Priority();
+  });
+
+  std::array<Timing, N> timing = {};
+  for (size_t r = 0; r < N; r++) {
+    auto const& m = messages[order[r]];
+    timing[r] = {
+        .c = m.WorstCaseBits(),
+        .t = uint64_t{m.period_ms} * bitrate / 1000,
+        .j = DivCeil(uint64_t{m.jitter_us} * bitrate, 1000000),
+        .priority = m.Priority(),
+    };
+    result.utilization_ppm += DivCeil(timing[r].c * 1000000, timing[r].t);
+    if (r > 0 && timing[r].priority == timing[r - 1].priority) {
+      result.unique = false;
+    }
+  }
+
+  CANPeriodic const longest = {.id = 0,
+                               .extended = true,
+                               .length = 8,
+                               .period_ms = 0,
+                               .offset_ms = kAutoOffset,
+                               .jitter_us = 0,
+                               .fill = nullptr};
+  uint64_t bus_limit = 0;  // Give up once a busy period exceeds this
+  for (auto const& t : timing) {
+    bus_limit = std::max(bus_limit, t.t * schedule_analysis::kMaxInstances);
+  }
+
+  for (size_t r = 0; r < N; r++) {
+    auto const& m = messages[order[r]];
+    auto const& self = timing[r];
+
+    uint64_t blocking = unknown_blocking ? longest.WorstCaseBits() : 0;
+    for (size_t k = r + 1; k < N; k++) {
+      blocking = std::max(blocking, timing[k].c);
+    }
+
+    // Level-m busy period
+    uint64_t busy = self.c;
+    bool converged = false;
+    while (busy <= bus_limit) {
+      uint64_t next = blocking;
+      for (size_t k = 0; k <= r; k++) {
+        next += DivCeil(busy + timing[k].j, timing[k].t) * timing[k].c;
+      }
+      if (next == busy) {
+        converged = true;
+        break;
+      }
+      busy = next;
+    }
+
+    uint64_t response = CANScheduleAnalysis<N>::kUnbounded;
+    if (converged) {
+      auto instances = DivCeil(busy + self.j, self.t);
+      response = 0;
+      auto limit = std::min(instances, schedule_analysis::kMaxInstances);
+      for (uint64_t q = 0; q < limit; q++) {
+        uint64_t w = blocking + q * self.c;
+        while (true) {
+          uint64_t next = blocking + q * self.c;
+          for (size_t k = 0; k < r; k++) {
+            next += DivCeil(w + timing[k].j + 1, timing[k].t) * timing[k].c;
+          }
+          if (next == w || next > bus_limit) {
+            w = next;
+            break;
+          }
+          w = next;
+        }
+        if (self.j + w + self.c > q * self.t) {
+          response = std::max(response, self.j + w + self.c - q * self.t);
+        }
+      }
+      if (instances > schedule_analysis::kMaxInstances) {
+        response = CANScheduleAnalysis<N>::kUnbounded;
+      }
+    }
+
+    bool received = order[r] >= local_count && accepts(m.id, m.extended);
+    result.messages[r] = {
+        .message = m,
+        .local = order[r] < local_count,
+        .received = received,
+        .frame_bits = static_cast<uint32_t>(self.c),
+        .blocking_bits = static_cast<uint32_t>(blocking),
+        .response_bits = response,
+        .deadline_bits = self.t,
+        .schedulable = response <= self.t,
+    };
+    if (received) {
+      result.rx_frames_per_ks += 1000000 / m.period_ms;
+    }
+    result.schedulable = result.schedulable && result.messages[r].schedulable;
+  }
+
+  result.schedulable = result.schedulable && result.unique &&
+                       result.utilization_ppm <= 1000000;
+  return result;
+}
+
+/// @brief Schedulability of this node's frames (Local::kTable) together with
+///        the traffic of the other nodes (Remote::kTable)
+/// @details Filters (a CANFilters / CANRouter, or void) marks the remote
+///          frames this node receives. Fails the build if a frame can miss
+///          its deadline (= its period).
+template <int kBitrate, typename Local, typename Remote = CANTraffic<>,
+          typename Filters = void>
+struct CANBusAnalysis {
+  static constexpr auto kMessages = [] {
+    constexpr auto kLocal = Local::kTable;
+    constexpr auto kRemote = Remote::kTable;
+    std::array<CANPeriodic, kLocal.size() + kRemote.size()> messages = {};
+    std::copy(kLocal.begin(), kLocal.end(), messages.begin());
+    std::copy(kRemote.begin(), kRemote.end(), messages.begin() + kLocal.size());
+    return messages;
+  }();
+
+  static constexpr auto kResult = AnalyzeCANSchedule(
+      kMessages, Local::kTable.size(), kBitrate,
+      [](uint32_t id, bool extended) {
+        if constexpr (std::is_void_v<Filters>) {
+          return false;
+        } else {
+          return Filters::Accepts(id, extended);
+        }
+      });
+
+  static_assert(kResult.unique, "CAN identifier used by more than one frame");
+  static_assert(kResult.utilization_ppm <= 1000000, "CAN bus is overloaded");
+  static_assert(kResult.schedulable,
+                "A CAN frame can miss its deadline (see CANBusAnalysis)");
+};
+
+}  // namespace stm32f3::can
@@ -0,0 +1,443 @@
+#pragma once
+
+#include <stm32f303x8.h>
+
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace stm32f3::can {
+struct CANMessage;
+
+static constexpr size_t kFilterBankCount = 14;
+static constexpr size_t kFilterNumberCount = kFilterBankCount * 4;  // per FIFO
+static constexpr uint8_t kNoRule = 0xFF;
+
+enum class CANIdFormat : uint8_t {
+  kStandard,  // 11-bit identifier
+  kExtended,  // 29-bit identifier
+  kAny,       // both; id/mask use the 29-bit layout (STID = bits 28:18)
+};
+
+/// @brief One acceptance rule: frames whose masked identifier equals the
+///        masked `id` are accepted into `fifo`
+struct CANFilterRule {
+  uint32_t id;
+  uint32_t mask;  // 1: the bit must match, 0: don't care
+  CANIdFormat format;
+  uint8_t fifo;
+
+  static constexpr uint32_t kStandardMask = 0x7FF;
+  static constexpr uint32_t kExtendedMask = 0x1FFFFFFF;
+
+  static constexpr CANFilterRule Standard(uint32_t id, uint8_t fifo = 0) {
+    return {id, kStandardMask, CANIdFormat::kStandard, fifo};
+  }
+  static constexpr CANFilterRule Extended(uint32_t id, uint8_t fifo = 0) {
+    return {id, kExtendedMask, CANIdFormat::kExtended, fifo};
+  }
+  static constexpr CANFilterRule StandardRange(uint32_t id, uint32_t mask,
+                                               uint8_t fifo = 0) {
+    return {id, mask, CANIdFormat::kStandard, fifo};
+  }
+  static constexpr CANFilterRule ExtendedRange(uint32_t id, uint32_t mask,
+                                               uint8_t fifo = 0) {
+    return {id, mask, CANIdFormat::kExtended, fifo};
+  }
+  static constexpr CANFilterRule AcceptAll(uint8_t fifo = 0) {
+    return {0, 0, CANIdFormat::kAny, fifo};
+  }
+
+  [[nodiscard]] constexpr bool IsExact() const {
+    switch (format) {
+      case CANIdFormat::kStandard:
+        return (mask & kStandardMask) == kStandardMask;
+      case CANIdFormat::kExtended:
+        return (mask & kExtendedMask) == kExtendedMask;
+      case CANIdFormat::kAny:
+        return false;
+    }
+    return false;
+  }
+
+  [[nodiscard]] constexpr bool IsValid() const {
+    if (fifo > 1) {
+      return false;
+    }
+    switch (format) {
+      case CANIdFormat::kStandard:
+        return id <= kStandardMask && mask <= kStandardMask;
+      case CANIdFormat::kExtended:
+      case CANIdFormat::kAny:
+        return id <= kExtendedMask && mask <= kExtendedMask;
+    }
+    return false;
+  }
+
+  /// @brief Whether a data frame with this identifier passes the rule
+  [[nodiscard]] constexpr bool Matches(uint32_t frame_id,
+                                       bool extended) const {
+    switch (format) {
+      case CANIdFormat::kStandard:
+        return !extended && (frame_id & mask) == (id & mask);
+      case CANIdFormat::kExtended:
+        return extended && (frame_id & mask) == (id & mask);
+      case CANIdFormat::kAny: {
+        auto layout = extended ? frame_id : frame_id << 18;
+        return (layout & mask) == (id & mask);
+      }
+    }
+    return false;
+  }
+
+  //* Register images (RM0316 "Filter bank scale and mode configuration")
+  //  32-bit: STID[10:0] EXID[17:0] IDE RTR 0
+  //  16-bit: STID[10:0] RTR IDE EXID[17:15]
+  [[nodiscard]] constexpr uint32_t Id32() const {
+    if (format == CANIdFormat::kStandard) {
+      return id << 21;
+    }
+    return (id << 3) | (format == CANIdFormat::kExtended ? 0b100 : 0);
+  }
+  [[nodiscard]] constexpr uint32_t Mask32() const {
+    if (format == CANIdFormat::kStandard) {
+      return (mask << 21) | 0b100;
+    }
+    return (mask << 3) | (format == CANIdFormat::kExtended ? 0b100 : 0);
+  }
+  [[nodiscard]] constexpr uint32_t Id16() const { return id << 5; }
+  [[nodiscard]] constexpr uint32_t Mask16() const {
+    return (mask << 5) | 0b1000;
+  }
+};
+
+enum class CANFilterScale : uint8_t { k16Bit, k32Bit };
+enum class CANFilterMode : uint8_t { kMask, kList };
+
+struct CANFilterBank {
+  CANFilterScale scale;
+  CANFilterMode mode;
+  uint8_t fifo;
+  uint32_t fr1;
+  uint32_t fr2;
+};
+
+template <size_t kRules>
+struct CANFilterLayout {
+  std::array<CANFilterBank, kFilterBankCount> banks;
+  size_t bank_count;  // may exceed kFilterBankCount (see `fits`)
+
+  std::array<uint8_t, kRules> fmi;  // filter match index of each rule
+  bool valid;                       // every rule is in range
+  bool fits;                        // bank_count <= kFilterBankCount
+
+  /// Rule index for each [fifo][filter match index] (kNoRule if unused);
+  /// padding entries of list/mask banks map to the rule they repeat
+  std::array<std::array<uint8_t, kFilterNumberCount>, 2> rule_of_fmi;
+};
+
+namespace filter_planner {
+template <size_t kRules>
+struct Builder {
+  CANFilterLayout<kRules> layout = {};
+  std::array<uint8_t, 2> next_fmi = {0, 0};
+
+  /// @param n   Number of entries the bank has (1, 2 or 4)
+  /// @param rules Rule index per entry; unused entries repeat the last one
+  constexpr void Emit(CANFilterScale scale, CANFilterMode mode, uint8_t fifo,
+                      uint32_t fr1, uint32_t fr2, size_t n,
+                      std::array<size_t, 4> const& rules, size_t used) {
+    if (layout.bank_count < kFilterBankCount) {
+      layout.banks[layout.bank_count] = {.scale = scale,
+                                         .mode = mode,
+                                         .fifo = fifo,
+                                         .fr1 = fr1,
+                                         .fr2 = fr2};
+    }
+    layout.bank_count++;
+
+    for (size_t i = 0; i < n; i++) {
+      auto number = next_fmi[fifo] + i;
+      if (i < used) {
+        layout.fmi[rules[i]] = static_cast<uint8_t>(number);
+      }
+      if (number < kFilterNumberCount) {
+        layout.rule_of_fmi[fifo][number] = static_cast<uint8_t>(rules[i]);
+      }
+    }
+    next_fmi[fifo] += n;
+  }
+};
+
+constexpr size_t DivCeil(size_t a, size_t b) {
+  return (a + b - 1) / b;
+}
+}  // namespace filter_planner
+
+/// @brief Packs the rules into filter banks, choosing scale and mode per bank
+/// @details Per FIFO, exact standard IDs go to 16-bit list banks (4 per bank),
+///          standard ranges to 16-bit mask banks (2), exact extended IDs to
+///          32-bit list banks (2) and the rest to 32-bit mask banks (1).
+///          Left-over exact standard IDs are moved into half-used mask/list
+///          banks when that saves a bank.
+template <size_t kRules>
+consteval CANFilterLayout<kRules> PlanFilterBanks(
+    std::array<CANFilterRule, kRules> const& rules) {
+  using filter_planner::DivCeil;
+
+  filter_planner::Builder<kRules> builder;
+  builder.layout.valid = true;
+  for (auto& table : builder.layout.rule_of_fmi) {
+    for (auto& rule : table) {
+      rule = kNoRule;
+    }
+  }
+
+  for (auto const& rule : rules) {
+    if (!rule.IsValid()) {
+      builder.layout.valid = false;
+    }
+  }
+
+  for (uint8_t fifo = 0; fifo < 2; fifo++) {
+    std::array<size_t, kRules> std_exact{}, std_mask{}, ext_exact{}, wide{};
+    size_t n_std_exact = 0, n_std_mask = 0, n_ext_exact = 0, n_wide = 0;
+
+    for (size_t i = 0; i < kRules; i++) {
+      auto const& rule = rules[i];
+      if (rule.fifo != fifo) {
+        continue;
+      }
+
+      if (rule.format == CANIdFormat::kStandard) {
+        if (rule.IsExact()) {
+          std_exact[n_std_exact++] = i;
+        } else {
+          std_mask[n_std_mask++] = i;
+        }
+      } else if (rule.format == CANIdFormat::kExtended && rule.IsExact()) {
+        ext_exact[n_ext_exact++] = i;
+      } else {
+        wide[n_wide++] = i;
+      }
+    }
+
+    // k1 exact standard IDs ride in 16-bit mask slots, k2 in 32-bit list slots
+    size_t best_k1 = 0, best_k2 = 0, best_banks = SIZE_MAX;
+    for (size_t k1 = 0; k1 <= 3 && k1 <= n_std_exact; k1++) {
+      for (size_t k2 = 0; k2 <= 1 && k1 + k2 <= n_std_exact; k2++) {
+        auto banks = DivCeil(n_std_exact - k1 - k2, 4) +
+                     DivCeil(n_std_mask + k1, 2) +
+                     DivCeil(n_ext_exact + k2, 2) + n_wide;
+        if (banks < best_banks) {
+          best_banks = banks;
+          best_k1 = k1;
+          best_k2 = k2;
+        }
+      }
+    }
+
+    // 16-bit list
+    for (size_t i = best_k1 + best_k2; i < n_std_exact; i += 4) {
+      std::array<size_t, 4> idx{};
+      size_t used = 0;
+      for (; used < 4 && i + used < n_std_exact; used++) {
+        idx[used] = std_exact[i + used];
+      }
+      for (size_t j = used; j < 4; j++) {
+        idx[j] = idx[used - 1];
+      }
+
+      builder.Emit(CANFilterScale::k16Bit, CANFilterMode::kList, fifo,
+                   rules[idx[0]].Id16() | (rules[idx[1]].Id16() << 16),
+                   rules[idx[2]].Id16() | (rules[idx[3]].Id16() << 16), 4, idx,
+                   used);
+    }
+
+    // 16-bit mask
+    {
+      std::array<size_t, kRules + 3> entries{};
+      size_t n = 0;
+      for (size_t i = 0; i < best_k1; i++) {
+        entries[n++] = std_exact[i];
+      }
+      for (size_t i = 0; i < n_std_mask; i++) {
+        entries[n++] = std_mask[i];
+      }
+
+      for (size_t i = 0; i < n; i += 2) {
+        std::array<size_t, 4> idx{entries[i], entries[i], 0, 0};
+        size_t used = 1;
+        if (i + 1 < n) {
+          idx[1] = entries[i + 1];
+          used = 2;
+        }
+
+        auto const& a = rules[idx[0]];
+        auto const& b = rules[idx[1]];
+        builder.Emit(CANFilterScale::k16Bit, CANFilterMode::kMask, fifo,
+                     a.Id16() | (a.Mask16() << 16),
+                     b.Id16() | (b.Mask16() << 16), 2, idx, used);
+      }
+    }
+
+    // 32-bit list
+    {
+      std::array<size_t, kRules + 1> entries{};
+      size_t n = 0;
+      for (size_t i = 0; i < n_ext_exact; i++) {
+        entries[n++] = ext_exact[i];
+      }
+      for (size_t i = best_k1; i < best_k1 + best_k2; i++) {
+        entries[n++] = std_exact[i];
+      }
+
+      for (size_t i = 0; i < n; i += 2) {
+        std::array<size_t, 4> idx{entries[i], entries[i], 0, 0};
+        size_t used = 1;
+        if (i + 1 < n) {
+          idx[1] = entries[i + 1];
+          used = 2;
+        }
+
+        builder.Emit(CANFilterScale::k32Bit, CANFilterMode::kList, fifo,
+                     rules[idx[0]].Id32(), rules[idx[1]].Id32(), 2, idx, used);
+      }
+    }
+
+    // 32-bit mask
+    for (size_t i = 0; i < n_wide; i++) {
+      auto const& rule = rules[wide[i]];
+      builder.Emit(CANFilterScale::k32Bit, CANFilterMode::kMask, fifo,
+                   rule.Id32(), rule.Mask32(), 1, {wide[i], 0, 0, 0}, 1);
+    }
+  }
+
+  builder.layout.fits = builder.layout.bank_count <= kFilterBankCount;
+  return builder.layout;
+}
+
+/// @brief Set of acceptance rules resolved into filter banks at compile time
+/// @note When rules overlap, the hardware reports the filter with the highest
+///       priority (32-bit before 16-bit, list before mask, then lower number).
+template <CANFilterRule... kRules>
+struct CANFilters {
+  static_assert(sizeof...(kRules) > 0, "At least one filter rule is required");
+
+  static constexpr std::array<CANFilterRule, sizeof...(kRules)> kRuleList = {
+      kRules...};
+  static constexpr auto kLayout = PlanFilterBanks(kRuleList);
+
+  static_assert(kLayout.valid, "CAN filter rule out of range (id/mask/fifo)");
+  static_assert(kLayout.fits, "CAN filter rules do not fit into 14 banks");
+
+  /// @brief Filter match index reported in RDTR.FMI for the i-th rule
+  static constexpr uint8_t FilterMatchIndex(size_t rule) {
+    return kLayout.fmi[rule];
+  }
+
+  /// @brief Whether any rule accepts a data frame with this identifier
+  static constexpr bool Accepts(uint32_t id, bool extended) {
+    for (auto const& rule : kRuleList) {
+      if (rule.Matches(id, extended)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static void Apply() {
+    CAN->FMR |= CAN_FMR_FINIT;  // Enter Filter Initialization Mode
+
+    CAN->FA1R = 0;  // Deactivate all banks
+
+    uint32_t fs1r = 0;   // 1: 32-bit scale
+    uint32_t fm1r = 0;   // 1: List mode
+    uint32_t ffa1r = 0;  // 1: FIFO 1
+    for (size_t i = 0; i < kLayout.bank_count; i++) {
+      auto const& bank = kLayout.banks[i];
+
+      if (bank.scale == CANFilterScale::k32Bit) {
+        fs1r |= 1 << i;
+      }
+      if (bank.mode == CANFilterMode::kList) {
+        fm1r |= 1 << i;
+      }
+      if (bank.fifo == 1) {
+        ffa1r |= 1 << i;
+      }
+
+      CAN->sFilterRegister[i].FR1 = bank.fr1;
+      CAN->sFilterRegister[i].FR2 = bank.fr2;
+    }
+    CAN->FS1R = fs1r;
+    CAN->FM1R = fm1r;
+    CAN->FFA1R = ffa1r;
+
+    CAN->FA1R = (1 << kLayout.bank_count) - 1;  // Activate used banks
+
+    CAN->FMR &= ~CAN_FMR_FINIT;  // Leave Filter Initialization Mode
+  }
+};
+
+using CANRxCallback = void (*)(CANMessage const&);
+
+/// @brief Filter rule bound to the callback that handles the frames it accepts
+template <CANFilterRule kRule_, CANRxCallback kCallback_ = nullptr>
+struct CANRoute {
+  static constexpr CANFilterRule kRule = kRule_;
+  static constexpr CANRxCallback kCallback = kCallback_;
+};
+
+/// @brief CANFilters whose frames are dispatched by filter match index
+/// @details Dispatch is a single table lookup with RDTR.FMI; frames of routes
+///          without a callback fall back to CANHandler::HandleRx.
+template <typename... Routes>
+struct CANRouter : CANFilters<Routes::kRule...> {
+  using Filters = CANFilters<Routes::kRule...>;
+
+  static constexpr auto kCallbacks = [] {
+    constexpr std::array<CANRxCallback, sizeof...(Routes)> callbacks = {
+        Routes::kCallback...};
+
+    std::array<std::array<CANRxCallback, kFilterNumberCount>, 2> table = {};
+    for (size_t fifo = 0; fifo < 2; fifo++) {
+      for (size_t fmi = 0; fmi < kFilterNumberCount; fmi++) {
+        auto rule = Filters::kLayout.rule_of_fmi[fifo][fmi];
+        table[fifo][fmi] = rule == kNoRule ? nullptr : callbacks[rule];
+      }
+    }
+    return table;
+  }();
+
+  /// @return false if no callback is bound to the filter
+  static bool Dispatch(uint32_t fifo, uint32_t fmi, CANMessage const& msg) {
+    if (fifo > 1 || fmi >= kFilterNumberCount) {
+      return false;
+    }
+
+    auto callback = kCallbacks[fifo][fmi];
+    if (callback == nullptr) {
+      return false;
+    }
+
+    callback(msg);
+    return true;
+  }
+};
+
+template <typename T>
+concept CANFiltersLike = requires {
+  {T::Apply()}->std::same_as<void>;
+  {T::FilterMatchIndex(0)}->std::convertible_to<uint8_t>;
+  {T::Accepts(0, false)}->std::convertible_to<bool>;
+};
+
+template <typename T>
+concept CANRouterLike = CANFiltersLike<T> && requires {
+  {T::Dispatch(0, 0, std::declval<CANMessage const&>())}->std::same_as<bool>;
+};
+
+}  // namespace stm32f3::can
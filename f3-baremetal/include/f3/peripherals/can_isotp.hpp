@@ -0,0 +1,560 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+//* ISO-TP (ISO 15765-2) over classic CAN
+//  The frame level state machines (ISOTPSender / ISOTPReceiver) only depend on
+//  the standard library, so they also build on the host against a virtual
+//  bus. ISOTPLink binds them to a BaremetalCAN instance.
+
+namespace stm32f3::can {
+
+/// @brief CAN payload as seen by ISO-TP (identifier is handled by the link)
+struct ISOTPFrame {
+  std::array<uint8_t, 8> data = {};
+  uint8_t length = 0;
+};
+
+struct ISOTPConfig {
+  /// Consecutive frames per flow control (0: no further flow control)
+  uint8_t block_size = 0;
+
+  /// Minimum separation time requested from the peer (raw STmin byte:
+  /// 0x00-0x7F = ms, 0xF1-0xF9 = 100-900 us)
+  uint8_t st_min = 0;
+
+  /// Pad every frame to 8 bytes (the length is still carried in the PCI)
+  bool padding = true;
+  uint8_t padding_byte = 0xCC;
+
+  /// N_As / N_Bs / N_Cr: give up if a frame is not transmitted, or the peer
+  /// stays silent, for this long
+  uint32_t timeout_us = 1000000;
+};
+
+enum class ISOTPError : uint8_t {
+  kNone,
+  kTimeout,        // N_As (not transmitted), N_Bs (no flow control) or
+                   // N_Cr (no consecutive frame)
+  kOverflow,       // Payload does not fit the buffer (ours or the peer's)
+  kWrongSequence,  // Consecutive frame with an unexpected sequence number
+  kInvalidFrame,   // Malformed PCI
+  kTooLong,        // More than isotp::kMaxPayload bytes
+  kEmptyPayload,   // Nothing to send (SF_DL 0 is reserved)
+};
+
+namespace isotp {
+static constexpr size_t kMaxPayload = 4095;  // 12-bit first frame length
+
+enum class PCI : uint8_t {
+  kSingle = 0x0,
+  kFirst = 0x1,
+  kConsecutive = 0x2,
+  kFlowControl = 0x3,
+};
+
+enum class FlowStatus : uint8_t {
+  kContinue = 0x0,
+  kWait = 0x1,
+  kOverflow = 0x2,
+};
+
+constexpr PCI TypeOf(ISOTPFrame const& frame) {
+  return static_cast<PCI>(frame.data[0] >> 4);
+}
+
+/// @brief Decode a raw STmin byte (reserved values mean 127 ms)
+constexpr uint32_t STminToMicros(uint8_t st_min) {
+  if (st_min <= 0x7F) {
+    return st_min * 1000u;
+  }
+  if (0xF1 <= st_min && st_min <= 0xF9) {
+    return (st_min - 0xF0) * 100u;
+  }
+  return 127000;
+}
+
+constexpr void Pad(ISOTPFrame& frame, ISOTPConfig const& config) {
+  if (!config.padding) {
+    return;
+  }
+  for (size_t i = frame.length; i < 8; i++) {
+    frame.data[i] = config.padding_byte;
+  }
+  frame.length = 8;
+}
+
+constexpr ISOTPFrame FlowControl(FlowStatus status, ISOTPConfig const& config) {
+  ISOTPFrame frame;
+  frame.data[0] = (static_cast<uint8_t>(PCI::kFlowControl) << 4) |
+                  static_cast<uint8_t>(status);
+  frame.data[1] = config.block_size;
+  frame.data[2] = config.st_min;
+  frame.length = 3;
+  Pad(frame, config);
+  return frame;
+}
+}  // namespace isotp
+
+/// @brief Segments one payload into SF / FF + CFs, honoring the peer's flow
+///        control; the payload is sent straight out of the caller's buffer
+/// @details One frame is in flight at a time: the next one is released by
+///          OnTxComplete, and STmin and N_Bs count from that point, so
+///          frames waiting in a TX queue cannot bunch up on the wire.
+class ISOTPSender {
+ public:
+  enum class State : uint8_t {
+    kIdle,
+    kSending,  // Frames are due (paced by STmin and TX completion)
+    kWaitFlowControl,
+    kDone,
+    kError,
+  };
+
+ private:
+  ISOTPConfig config_;
+
+  std::span<const uint8_t> payload_;
+  size_t offset_ = 0;
+  uint8_t sequence_ = 0;
+
+  uint8_t block_size_ = 0;  // From the peer's flow control
+  uint8_t block_count_ = 0;
+  uint32_t separation_us_ = 0;
+
+  bool paced_ = false;      // A CF was sent; the next waits for STmin
+  bool in_flight_ = false;  // Handed to `send`, not yet transmitted
+  uint32_t last_tx_us_ = 0;  // Completion of the last frame / its hand-off
+  uint32_t wait_since_us_ = 0;
+
+  State state_ = State::kIdle;
+  ISOTPError error_ = ISOTPError::kNone;
+
+  void Fail(ISOTPError error) {
+    state_ = State::kError;
+    error_ = error;
+  }
+
+  ISOTPFrame NextFrame() const {
+    ISOTPFrame frame;
+    auto remaining = payload_.size() - offset_;
+
+    if (offset_ == 0 && payload_.size() <= 7) {
+      frame.data[0] = (static_cast<uint8_t>(isotp::PCI::kSingle) << 4) |
+                      static_cast<uint8_t>(payload_.size());
+      std::copy(payload_.begin(), payload_.end(), frame.data.begin() + 1);
+      frame.length = 1 + payload_.size();
+    } else if (offset_ == 0) {
+      frame.data[0] = (static_cast<uint8_t>(isotp::PCI::kFirst) << 4) |
+                      static_cast<uint8_t>(payload_.size() >> 8);
+      frame.data[1] = static_cast<uint8_t>(payload_.size());
+      std::copy_n(payload_.begin(), 6, frame.data.begin() + 2);
+      frame.length = 8;
+    } else {
+      auto n = std::min<size_t>(remaining, 7);
+      frame.data[0] = (static_cast<uint8_t>(isotp::PCI::kConsecutive) << 4) |
+                      sequence_;
+      std::copy_n(payload_.begin() + offset_, n, frame.data.begin() + 1);
+      frame.length = 1 + n;
+    }
+
+    isotp::Pad(frame, config_);
+    return frame;
+  }
+
+  /// @brief The frame from NextFrame() was handed to the bus
+  void Advance() {
+    if (offset_ == 0 && payload_.size() <= 7) {
+      offset_ = payload_.size();
+      return;
+    }
+
+    if (offset_ == 0) {
+      offset_ = 6;
+      sequence_ = 1;
+      return;
+    }
+
+    offset_ += std::min<size_t>(payload_.size() - offset_, 7);
+    sequence_ = (sequence_ + 1) & 0xF;
+    paced_ = true;
+  }
+
+ public:
+  constexpr explicit ISOTPSender(ISOTPConfig const& config = {})
+      : config_(config) {}
+
+  [[nodiscard]] State GetState() const { return state_; }
+  [[nodiscard]] ISOTPError GetError() const { return error_; }
+  [[nodiscard]] bool Busy() const {
+    return state_ == State::kSending || state_ == State::kWaitFlowControl;
+  }
+  /// @brief A frame was handed to the bus and has not completed yet
+  [[nodiscard]] bool InFlight() const { return in_flight_; }
+  [[nodiscard]] size_t Sent() const { return offset_; }
+
+  /// @param payload Must stay valid until the transfer leaves Busy()
+  /// @return false if a transfer is running or the payload is empty or too
+  ///         long
+  bool Start(std::span<const uint8_t> payload) {
+    if (Busy()) {
+      return false;
+    }
+    if (payload.empty()) {
+      Fail(ISOTPError::kEmptyPayload);
+      return false;
+    }
+    if (payload.size() > isotp::kMaxPayload) {
+      Fail(ISOTPError::kTooLong);
+      return false;
+    }
+
+    payload_ = payload;
+    offset_ = 0;
+    sequence_ = 0;
+    block_size_ = 0;
+    block_count_ = 0;
+    separation_us_ = 0;
+    paced_ = false;
+    in_flight_ = false;
+    state_ = State::kSending;
+    error_ = ISOTPError::kNone;
+    return true;
+  }
+
+  /// @note A frame in flight still completes; its OnTxComplete is ignored
+  void Abort() {
+    if (Busy()) {
+      state_ = State::kIdle;
+      in_flight_ = false;
+    }
+  }
+
+  /// @brief Hand the due frame to `send` (bool(ISOTPFrame const&)); a frame
+  ///        that `send` refuses is offered again on the next call
+  /// @return true if a frame was sent
+  template <typename Send>
+  bool Poll(uint32_t now_us, Send&& send) {
+    if (state_ == State::kWaitFlowControl) {
+      if (now_us - wait_since_us_ >= config_.timeout_us) {
+        Fail(ISOTPError::kTimeout);
+      }
+      return false;
+    }
+    if (state_ != State::kSending) {
+      return false;
+    }
+    if (in_flight_) {
+      if (now_us - last_tx_us_ >= config_.timeout_us) {
+        Fail(ISOTPError::kTimeout);
+      }
+      return false;
+    }
+    if (paced_ && now_us - last_tx_us_ < separation_us_) {
+      return false;
+    }
+
+    if (!send(NextFrame())) {
+      return false;
+    }
+    Advance();
+    in_flight_ = true;
+    last_tx_us_ = now_us;
+    return true;
+  }
+
+  /// @brief The frame handed out by Poll is on the wire (TX complete)
+  void OnTxComplete(uint32_t now_us) {
+    if (!in_flight_) {
+      return;
+    }
+    in_flight_ = false;
+    last_tx_us_ = now_us;
+
+    if (offset_ == payload_.size()) {
+      state_ = State::kDone;
+    } else if (offset_ == 6 ||
+               (block_size_ != 0 && ++block_count_ == block_size_)) {
+      state_ = State::kWaitFlowControl;  // After the FF or a full block
+      wait_since_us_ = now_us;
+    }
+  }
+
+  /// @brief Feed a flow control frame received from the peer
+  void OnFlowControl(ISOTPFrame const& frame, uint32_t now_us) {
+    bool ends_block = offset_ == 6 || (block_size_ != 0 &&
+                                       block_count_ + 1 == block_size_);
+    if (in_flight_ && ends_block && offset_ != payload_.size()) {
+      OnTxComplete(now_us);  // The peer answered it, so it was transmitted
+    }
+    if (state_ != State::kWaitFlowControl) {
+      return;  // Unexpected flow control is ignored
+    }
+    if (frame.length < 3) {
+      Fail(ISOTPError::kInvalidFrame);
+      return;
+    }
+
+    switch (static_cast<isotp::FlowStatus>(frame.data[0] & 0xF)) {
+      case isotp::FlowStatus::kContinue:
+        block_size_ = frame.data[1];
+        block_count_ = 0;
+        separation_us_ = isotp::STminToMicros(frame.data[2]);
+        paced_ = false;  // The first CF of a block goes out immediately
+        state_ = State::kSending;
+        break;
+      case isotp::FlowStatus::kWait:
+        wait_since_us_ = now_us;
+        break;
+      case isotp::FlowStatus::kOverflow:
+        Fail(ISOTPError::kOverflow);
+        break;
+      default:
+        Fail(ISOTPError::kInvalidFrame);
+        break;
+    }
+  }
+};
+
+/// @brief Reassembles one payload directly into a caller-provided buffer
+class ISOTPReceiver {
+ public:
+  enum class State : uint8_t {
+    kIdle,       // No buffer; frames are ignored
+    kListening,  // Waiting for SF / FF
+    kReceiving,  // Waiting for CFs
+    kDone,       // Data() is valid until the next Listen()
+    kError,
+  };
+
+ private:
+  ISOTPConfig config_;
+
+  std::span<uint8_t> buffer_;
+  size_t length_ = 0;
+  size_t offset_ = 0;
+  uint8_t sequence_ = 0;
+  uint8_t block_count_ = 0;
+
+  bool fc_pending_ = false;
+  isotp::FlowStatus fc_status_ = isotp::FlowStatus::kContinue;
+  uint32_t last_rx_us_ = 0;
+
+  State state_ = State::kIdle;
+  ISOTPError error_ = ISOTPError::kNone;
+
+  void Fail(ISOTPError error) {
+    state_ = State::kError;
+    error_ = error;
+  }
+
+  void RequestFlowControl(isotp::FlowStatus status) {
+    fc_pending_ = true;
+    fc_status_ = status;
+  }
+
+  void OnSingle(ISOTPFrame const& frame) {
+    size_t length = frame.data[0] & 0xF;
+    if (length == 0 || length > 7 || frame.length < 1 + length) {
+      Fail(ISOTPError::kInvalidFrame);
+      return;
+    }
+    if (length > buffer_.size()) {
+      Fail(ISOTPError::kOverflow);
+      return;
+    }
+
+    std::copy_n(frame.data.begin() + 1, length, buffer_.begin());
+    length_ = offset_ = length;
+    state_ = State::kDone;
+  }
+
+  void OnFirst(ISOTPFrame const& frame, uint32_t now_us) {
+    size_t length = ((frame.data[0] & 0xF) << 8) | frame.data[1];
+    if (length < 8 || frame.length < 8) {
+      Fail(ISOTPError::kInvalidFrame);
+      return;
+    }
+    if (length > buffer_.size()) {
+      RequestFlowControl(isotp::FlowStatus::kOverflow);
+      Fail(ISOTPError::kOverflow);
+      return;
+    }
+
+    std::copy_n(frame.data.begin() + 2, 6, buffer_.begin());
+    length_ = length;
+    offset_ = 6;
+    sequence_ = 1;
+    block_count_ = 0;
+    last_rx_us_ = now_us;
+    state_ = State::kReceiving;
+    RequestFlowControl(isotp::FlowStatus::kContinue);
+  }
+
+  void OnConsecutive(ISOTPFrame const& frame, uint32_t now_us) {
+    if (state_ != State::kReceiving) {
+      return;  // Not ours (or a late frame of an aborted transfer)
+    }
+    if ((frame.data[0] & 0xF) != sequence_) {
+      Fail(ISOTPError::kWrongSequence);
+      return;
+    }
+
+    auto n = std::min<size_t>(length_ - offset_, 7);
+    if (frame.length < 1 + n) {
+      Fail(ISOTPError::kInvalidFrame);
+      return;
+    }
+
+    std::copy_n(frame.data.begin() + 1, n, buffer_.begin() + offset_);
+    offset_ += n;
+    sequence_ = (sequence_ + 1) & 0xF;
+    last_rx_us_ = now_us;
+
+    if (offset_ == length_) {
+      state_ = State::kDone;
+    } else if (config_.block_size != 0 &&
+               ++block_count_ == config_.block_size) {
+      block_count_ = 0;
+      RequestFlowControl(isotp::FlowStatus::kContinue);
+    }
+  }
+
+ public:
+  constexpr explicit ISOTPReceiver(ISOTPConfig const& config = {})
+      : config_(config) {}
+
+  [[nodiscard]] State GetState() const { return state_; }
+  [[nodiscard]] ISOTPError GetError() const { return error_; }
+  [[nodiscard]] bool Done() const { return state_ == State::kDone; }
+  [[nodiscard]] size_t Received() const { return offset_; }
+  [[nodiscard]] std::span<const uint8_t> Data() const {
+    return buffer_.first(offset_);
+  }
+
+  /// @brief Arm the receiver; `buffer` is owned by the receiver until
+  ///        Done() or an error, and bounds the accepted payload length
+  void Listen(std::span<uint8_t> buffer) {
+    buffer_ = buffer;
+    length_ = offset_ = 0;
+    fc_pending_ = false;
+    state_ = State::kListening;
+    error_ = ISOTPError::kNone;
+  }
+
+  /// @brief Feed a SF / FF / CF received from the peer
+  void OnFrame(ISOTPFrame const& frame, uint32_t now_us) {
+    if (state_ != State::kListening && state_ != State::kReceiving) {
+      return;
+    }
+    if (frame.length == 0) {
+      return;
+    }
+
+    switch (isotp::TypeOf(frame)) {
+      case isotp::PCI::kSingle:  // SF / FF also restart a running transfer
+        fc_pending_ = false;
+        OnSingle(frame);
+        break;
+      case isotp::PCI::kFirst:
+        fc_pending_ = false;
+        OnFirst(frame, now_us);
+        break;
+      case isotp::PCI::kConsecutive:
+        OnConsecutive(frame, now_us);
+        break;
+      default:
+        break;
+    }
+  }
+
+  /// @brief Send a pending flow control through `send` (bool(ISOTPFrame
+  ///        const&)) and check the N_Cr timeout
+  template <typename Send>
+  void Poll(uint32_t now_us, Send&& send) {
+    if (fc_pending_ && send(isotp::FlowControl(fc_status_, config_))) {
+      fc_pending_ = false;
+      last_rx_us_ = now_us;  // N_Cr counts from the flow control
+    }
+
+    if (state_ == State::kReceiving && !fc_pending_ &&
+        now_us - last_rx_us_ >= config_.timeout_us) {
+      Fail(ISOTPError::kTimeout);
+    }
+  }
+};
+
+/// @brief One ISO-TP connection (a TX / RX identifier pair) on a BaremetalCAN
+/// @details HandleRx, HandleTxComplete and Poll are not interrupt safe against
+///          each other: call them from the same context, e.g. from handlers
+///          run by ProcessDeferredRx and from the main loop. The sender only
+///          advances when HandleTxComplete sees its frames complete.
+template <typename Bus, uint32_t kTxId, uint32_t kRxId, bool kExtended = false>
+class ISOTPLink {
+  using Message = typename Bus::Message;
+
+  ISOTPSender sender_;
+  ISOTPReceiver receiver_;
+
+  static bool SendFrame(ISOTPFrame const& frame) {
+    Message message{};
+    message.id = kTxId;
+    message.extended = kExtended;
+    message.length = frame.length;
+    std::copy_n(frame.data.begin(), frame.length, message.data.begin());
+    return Bus::Send(message);
+  }
+
+ public:
+  explicit ISOTPLink(ISOTPConfig const& config = {})
+      : sender_(config), receiver_(config) {}
+
+  ISOTPSender& Sender() { return sender_; }
+  ISOTPReceiver& Receiver() { return receiver_; }
+
+  /// @return true if the frame belongs to this link
+  bool HandleRx(Message const& message, uint32_t now_us) {
+    if (message.id != kRxId || message.extended != kExtended ||
+        message.remote || message.length == 0) {
+      return false;
+    }
+
+    ISOTPFrame frame;
+    frame.length = std::min<uint32_t>(message.length, 8);
+    std::copy_n(message.data.begin(), frame.length, frame.data.begin());
+
+    if (isotp::TypeOf(frame) == isotp::PCI::kFlowControl) {
+      sender_.OnFlowControl(frame, now_us);
+    } else {
+      receiver_.OnFrame(frame, now_us);
+    }
+    return true;
+  }
+
+  /// @brief Feed a completed transmission (Handler::HandleTxComplete)
+  /// @return true if the frame belongs to this link
+  bool HandleTxComplete(Message const& message, uint32_t now_us) {
+    if (message.id != kTxId || message.extended != kExtended ||
+        message.length == 0) {
+      return false;
+    }
+    if (static_cast<isotp::PCI>(message.data[0] >> 4) !=
+        isotp::PCI::kFlowControl) {
+      sender_.OnTxComplete(now_us);
+    }
+    return true;
+  }
+
+  /// @brief Non-blocking: emits a pending flow control and the next due
+  ///        frame of the sender
+  void Poll(uint32_t now_us) {
+    receiver_.Poll(now_us, SendFrame);
+    sender_.Poll(now_us, SendFrame);
+  }
+};
+
+}  // namespace stm32f3::can
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <f3/critical_section.hpp>
+#include <f3/peripherals/basic_timer.hpp>
+#include <f3/peripherals/can.hpp>
+#include <f3/peripherals/can_analysis.hpp>
+
+namespace stm32f3::can {
+namespace schedule_planner {
+static constexpr size_t kMaxWindowMs = 1000;
+
+constexpr uint32_t Gcd(uint32_t a, uint32_t b) {
+  while (b != 0) {
+    auto t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+/// @brief Hyperperiod of the table, capped at kMaxWindowMs
+template <size_t N>
+constexpr uint32_t Window(std::array<CANPeriodic, N> const& entries) {
+  uint64_t window = 1;
+  for (auto const& entry : entries) {
+    window = window / Gcd(window, entry.period_ms) * entry.period_ms;
+    if (window > kMaxWindowMs) {
+      return kMaxWindowMs;
+    }
+  }
+  return window;
+}
+}  // namespace schedule_planner
+
+/// @brief Choose release offsets that flatten the per-millisecond bus load
+/// @details Fixed offsets are placed first. The others follow in rate
+///          monotonic order and each takes the offset whose busiest
+///          millisecond over the hyperperiod is the least loaded.
+template <size_t N>
+consteval std::array<uint32_t, N> PlanScheduleOffsets(
+    std::array<CANPeriodic, N> const& entries) {
+  auto window = schedule_planner::Window(entries);
+  std::array<uint32_t, schedule_planner::kMaxWindowMs> load = {};
+
+  std::array<size_t, N> order = {};
+  for (size_t i = 0; i < N; i++) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    auto const& ea = entries[a];
+    auto const& eb = entries[b];
+    bool fixed_a = ea.offset_ms != kAutoOffset;
+    bool fixed_b = eb.offset_ms != kAutoOffset;
+    if (fixed_a != fixed_b) {
+      return fixed_a;
+    }
+    if (ea.period_ms != eb.period_ms) {
+      return ea.period_ms < eb.period_ms;
+    }
+    return ea.id < eb.id;
+  });
+
+  std::array<uint32_t, N> offsets = {};
+  for (auto i : order) {
+    auto const& entry = entries[i];
+
+    uint32_t offset = 0;
+    if (entry.offset_ms != kAutoOffset) {
+      offset = entry.offset_ms % entry.period_ms;
+    } else {
+      uint32_t best_peak = UINT32_MAX;
+      auto candidates = std::min(entry.period_ms, window);
+      for (uint32_t o = 0; o < candidates; o++) {
+        uint32_t peak = 0;
+        for (uint32_t t = o; t < window; t += entry.period_ms) {
+          peak = std::max(peak, load[t]);
+        }
+        if (peak < best_peak) {
+          best_peak = peak;
+          offset = o;
+        }
+      }
+    }
+
+    for (uint32_t t = offset; t < window; t += entry.period_ms) {
+      load[t] += entry.WorstCaseBits();
+    }
+    offsets[i] = offset;
+  }
+
+  return offsets;
+}
+
+struct CANScheduleStatistic {
+  unsigned int released;  // Handed to SendLatest
+  unsigned int dropped;   // TX queue full
+  unsigned int overruns;  // Previous instance still pending (replaced)
+  unsigned int sent;      // Completed (needs OnTxComplete)
+
+  // Deviation of the completion interval from the period [us]
+  int jitter_min_us;
+  int jitter_max_us;
+  unsigned int jitter_abs_sum_us;
+  unsigned int jitter_samples;
+};
+
+/// @brief Releases a fixed table of periodic frames from BasicTimer<7>
+/// @details Frames go out through Bus::SendLatest, so a frame that is still
+///          queued when its next instance is due is replaced rather than
+///          duplicated. Forward Handler::HandleTxComplete to OnTxComplete to
+///          collect completion jitter.
+template <typename Bus, CANPeriodic... kEntries>
+class CANScheduler {
+ public:
+  using Timer = basic_timer::BasicTimer<7>;
+
+  static constexpr std::array<CANPeriodic, sizeof...(kEntries)> kTable = {
+      kEntries...};
+  static constexpr auto kOffsets = PlanScheduleOffsets(kTable);
+
+  /// Response time analysis of this table plus the other nodes' traffic
+  template <int kBitrate, typename Remote = CANTraffic<>,
+            typename Filters = void>
+  using Analysis = CANBusAnalysis<kBitrate, CANScheduler, Remote, Filters>;
+
+ private:
+  static_assert(sizeof...(kEntries) > 0, "Empty schedule");
+  static_assert(((kEntries.period_ms > 0) && ...), "Period must be >= 1 ms");
+  static_assert(((kEntries.length <= 8) && ...), "DLC must be <= 8");
+
+  struct Slot {
+    uint32_t next_due_ms;
+    std::array<uint8_t, 8> data;
+    bool pending;
+    bool has_last;
+    uint32_t last_tx_us;
+    CANScheduleStatistic statistic;
+  };
+
+  static uint32_t NowUs() {
+    auto ms = now_ms_;
+    auto count = Timer::GetCounter();
+    if (Timer::IsUpdatePending() && count < counts_per_ms_ / 2) {
+      ms++;  // Wrapped after the ISR read, before OnTick ran
+    }
+    return ms * 1000 + count * 1000 / counts_per_ms_;
+  }
+
+  static void Release(size_t i) {
+    auto const& entry = kTable[i];
+    auto& slot = slots_[i];
+
+    CANMessage message{.id = entry.id,
+                       .length = entry.length,
+                       .data = slot.data,
+                       .extended = entry.extended};
+    if (entry.fill) {
+      entry.fill(message);
+    }
+
+    if (slot.pending) {
+      slot.statistic.overruns++;
+    }
+    if (!Bus::SendLatest(message)) {
+      slot.statistic.dropped++;
+      return;
+    }
+    slot.statistic.released++;
+    slot.pending = true;
+  }
+
+ public:
+  /// @brief Start releasing frames; the timer interrupt runs every 1 ms
+  /// @tparam kBitrate Fails the build if this table alone cannot meet its
+  ///         deadlines at this bit rate (use Analysis<> to add the traffic of
+  ///         the other nodes)
+  template <rcc::RCCConfigLike kRcc, int kBitrate>
+  static void Start() {
+    static_assert(Analysis<kBitrate>::kResult.schedulable);
+
+    constexpr auto config = Timer::CalculateConfig<1000, kRcc>();
+    counts_per_ms_ = config.auto_reload_value;
+
+    now_ms_ = 0;
+    for (size_t i = 0; i < kTable.size(); i++) {
+      slots_[i] = Slot{};
+      slots_[i].next_due_ms = kOffsets[i];
+      slots_[i].statistic.jitter_min_us = INT32_MAX;
+      slots_[i].statistic.jitter_max_us = INT32_MIN;
+    }
+
+    Timer::Init<1000, kRcc, CANScheduler>();
+  }
+
+  static void OnTick() {
+    auto now = now_ms_;
+    for (size_t i = 0; i < kTable.size(); i++) {
+      auto& slot = slots_[i];
+      if (static_cast<int32_t>(now - slot.next_due_ms) < 0) {
+        continue;
+      }
+
+      Release(i);
+      slot.next_due_ms += kTable[i].period_ms;
+    }
+    now_ms_ = now + 1;
+  }
+
+  /// @brief Call from Handler::HandleTxComplete
+  static void OnTxComplete(CANMessage const& message) {
+    for (size_t i = 0; i < kTable.size(); i++) {
+      if (kTable[i].id != message.id ||
+          kTable[i].extended != message.extended) {
+        continue;
+      }
+
+      auto now = NowUs();
+      auto& slot = slots_[i];
+      slot.pending = false;
+      slot.statistic.sent++;
+
+      if (slot.has_last) {
+        auto& statistic = slot.statistic;
+        int jitter = static_cast<int>(now - slot.last_tx_us) -
+                     static_cast<int>(kTable[i].period_ms * 1000);
+        statistic.jitter_min_us = std::min(statistic.jitter_min_us, jitter);
+        statistic.jitter_max_us = std::max(statistic.jitter_max_us, jitter);
+        statistic.jitter_abs_sum_us += jitter < 0 ? -jitter : jitter;
+        statistic.jitter_samples++;
+      }
+      slot.has_last = true;
+      slot.last_tx_us = now;
+      return;
+    }
+  }
+
+  /// @brief Set the payload of entry kIndex (used when it has no `fill`)
+  template <size_t kIndex>
+  static void Update(std::array<uint8_t, 8> const& data) {
+    static_assert(kIndex < kTable.size());
+    CriticalSection lock;
+    slots_[kIndex].data = data;
+  }
+
+  static CANScheduleStatistic GetStatistic(size_t index) {
+    CriticalSection lock;
+    return slots_[index].statistic;
+  }
+
+ private:
+  static inline volatile uint32_t now_ms_ = 0;
+  static inline uint32_t counts_per_ms_ = 1;
+  static inline std::array<Slot, sizeof...(kEntries)> slots_ = {};
+};
+
+}  // namespace stm32f3::can
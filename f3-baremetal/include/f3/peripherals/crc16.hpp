@@ -1,28 +1,41 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 #include <stm32f303x8.h>
 
 namespace stm32f3 {
-template <uint16_t kPolynomial>
+/// @brief 16-bit CRC on the CRC peripheral, MSB first (no reflection, no
+///        final XOR); e.g. <0x1021, 0xFFFF> is CRC-16/CCITT-FALSE
+/// @note  Each instance restarts the calculation; the peripheral is shared,
+///        so use it from one context at a time
+template <uint16_t kPolynomial, uint16_t kInit = 0>
 class CRC16 {
  public:
   CRC16() {
-    CRC->INIT = 0;
-    CRC->CR |= ~CRC_CR_REV_OUT_Msk;
-    CRC->CR &= ~CRC_CR_REV_IN_Msk;
-    CRC->CR |= 0b01U << CRC_CR_REV_IN_Pos;
-    CRC->CR &= ~CRC_CR_POLYSIZE_Msk;
-    CRC->CR |= 0b01U << CRC_CR_POLYSIZE_Pos;  // 16bit
+    RCC->AHBENR |= RCC_AHBENR_CRCEN;
+
+    CRC->CR = 0b01U << CRC_CR_POLYSIZE_Pos;  // 16bit, REV_IN/REV_OUT off
     CRC->POL = kPolynomial;
+    CRC->INIT = kInit;
     CRC->CR |= CRC_CR_RESET_Msk;
   }
 
   auto operator<<(uint8_t val) -> CRC16& {
-    CRC->DR = val;
+    // A byte access feeds 8 bits; a word access would feed 32
+    *reinterpret_cast<volatile uint8_t*>(&CRC->DR) = val;
+    return *this;
+  }
+
+  auto Update(uint8_t const* data, size_t length) -> CRC16& {
+    for (size_t i = 0; i < length; i++) {
+      *this << data[i];
+    }
     return *this;
   }
 
   // NOLINTNEXTLINE(readability-convert-member-functions-to-static)
   [[nodiscard]] auto Value() const -> uint16_t { return CRC->DR; }
 };
-}  // namespace stm32f3
\ No newline at end of file
+}  // namespace stm32f3
@@ -20,6 +20,23 @@ class DMA {
   constexpr static DMA_Channel_TypeDef* ChannelBase(int channel) {
     return (DMA_Channel_TypeDef*)(DMA1_Channel1_BASE + (channel - 1) * 0x14);
   }
+
+  constexpr static IRQn_Type ChannelIRQn(int channel) {
+    return static_cast<IRQn_Type>(DMA1_Channel1_IRQn + (channel - 1));
+  }
+
+  //* Per-channel interrupt flags (ISR / IFCR)
+  static constexpr uint32_t kGlobalFlag = 1 << 0;
+  static constexpr uint32_t kCompleteFlag = 1 << 1;
+  static constexpr uint32_t kHalfFlag = 1 << 2;
+  static constexpr uint32_t kErrorFlag = 1 << 3;
+
+  static uint32_t Flags(int channel) {
+    return (DMA1->ISR >> (4 * (channel - 1))) & 0xF;
+  }
+  static void ClearFlags(int channel, uint32_t flags) {
+    DMA1->IFCR = flags << (4 * (channel - 1));
+  }
 };
 
 static_assert(DMALike<DMA<1>>);
@@ -13,6 +13,68 @@
 #include <f3/ram_vector.hpp>
 
 namespace stm32f3 {
+namespace usart {
+/// Kernel clock of a USART (RCC_CFGR3 USARTxSW)
+enum class ClockSource : uint32_t {
+  kPCLK = 0b00,
+  kSYSCLK = 0b01,
+  kHSI = 0b11,
+};
+
+/// HSI factory trim over temperature: HSI is only picked over a bus clock
+/// if its divider is better by more than this
+static constexpr int32_t kHSIAccuracyPpm = 10000;
+
+/// Half of what an 8N1 receiver tolerates (~4 %); the peer gets the rest
+static constexpr int32_t kMaxBaudErrorPpm = 20000;
+
+struct BaudSetting {
+  ClockSource source;
+  uint32_t clock;      // Kernel clock
+  bool over8;          // 8x oversampling
+  uint32_t brr;        // 0: the clock cannot reach the baud rate
+  uint32_t baudrate;   // Achieved
+  int32_t error_ppm;   // (achieved - requested) / requested
+};
+
+/// @brief Nearest divider of `clock` for `baudrate`
+/// @details USARTDIV = clock / baudrate either way; 16x oversampling holds
+///          it in BRR as is, 8x keeps its low 3 bits in BRR[2:0]. 8x only
+///          serves dividers 8..15 (baud rates above clock / 16), as it
+///          tolerates less noise and clock error.
+constexpr BaudSetting SolveBaud(ClockSource source, uint32_t clock,
+                                uint32_t baudrate) {
+  BaudSetting setting{.source = source,
+                      .clock = clock,
+                      .over8 = false,
+                      .brr = 0,
+                      .baudrate = 0,
+                      .error_ppm = 0};
+  auto div = (static_cast<uint64_t>(clock) + baudrate / 2) / baudrate;
+  if (div < 8 || 0xFFFF < div) {
+    return setting;
+  }
+
+  setting.over8 = div < 16;
+  setting.brr = setting.over8 ? (div >> 3) << 4 | (div & 0b111) : div;
+  setting.baudrate = (clock + div / 2) / div;
+  setting.error_ppm = static_cast<int32_t>(
+      (static_cast<int64_t>(clock) * 1000000 / static_cast<int64_t>(div) -
+       static_cast<int64_t>(baudrate) * 1000000) /
+      baudrate);
+  return setting;
+}
+
+constexpr int32_t ErrorScore(BaudSetting const& setting) {
+  auto error = setting.error_ppm < 0 ? -setting.error_ppm : setting.error_ppm;
+  return error + (setting.source == ClockSource::kHSI ? kHSIAccuracyPpm : 0);
+}
+
+constexpr bool IsBetter(BaudSetting const& a, BaudSetting const& b) {
+  return a.brr != 0 && (b.brr == 0 || ErrorScore(a) < ErrorScore(b));
+}
+}  // namespace usart
+
 template <typename T>
 concept USARTHandler = requires(T t) {
   { t.HandleRx(std::declval<char>()) } -> std::same_as<void>;
@@ -44,10 +106,26 @@ class USART {
                            : UsageFault_IRQn;
   static_assert(IRQn != UsageFault_IRQn, "Invalid peripheral id");
 
+#ifdef RCC_CFGR3_USART2SW
+  static constexpr bool kHasClockSwitch = true;
+  static constexpr auto kClockSwitchPos =
+      kPeripheralId == 1   ? RCC_CFGR3_USART1SW_Pos
+      : kPeripheralId == 2 ? RCC_CFGR3_USART2SW_Pos
+                           : RCC_CFGR3_USART3SW_Pos;
+#else
+  // F303x6/x8: USART2/3 always run on PCLK1
+  static constexpr bool kHasClockSwitch = kPeripheralId == 1;
+  static constexpr auto kClockSwitchPos = RCC_CFGR3_USART1SW_Pos;
+#endif
+
   static void Rx_IRQHandler() {
-    if (Instance()->ISR & USART_ISR_RXNE) {
+    auto isr = Instance()->ISR;
+    if (isr & USART_ISR_RXNE) {
       Handlers::HandleRx(Instance()->RDR);
     }
+    if (isr & USART_ISR_ORE) {
+      Instance()->ICR = USART_ICR_ORECF;  // Would re-enter the IRQ forever
+    }
   }
 
   static auto RCCClockRegister() {
@@ -59,32 +137,72 @@ class USART {
   }
 
  public:
+  /// DMA1 channels of the USART's TX / RX requests
+  static constexpr int kTxDMAChannel = kPeripheralId == 1   ? 4
+                                       : kPeripheralId == 2 ? 7
+                                                            : 2;
+  static constexpr int kRxDMAChannel = kPeripheralId == 1   ? 5
+                                       : kPeripheralId == 2 ? 6
+                                                            : 3;
+
   static USART_TypeDef* Instance() {
     return reinterpret_cast<USART_TypeDef*>(usart);
   }
 
   static void ConfigureSwap() { Instance()->CR2 |= USART_CR2_SWAP; }
 
-  template <int kBaudrate, rcc::RCCConfigLike kRcc, bool force_init = false>
-  static void Configure() {
-    static constexpr auto kBusClock =
-        kPeripheralId == 1   ? kRcc::GetAPB2Clock()
-        : kPeripheralId == 2 ? kRcc::GetAPB1Clock()
-        : kPeripheralId == 3 ? kRcc::GetAPB1Clock()
-                             : kRcc::GetAPB2Clock();
-
-    constexpr float real_baudrate = kBusClock / (int)(kBusClock / kBaudrate);
-    constexpr float error_rate = (real_baudrate - kBaudrate) / kBaudrate;
-    if (!force_init) {
-      static_assert(-0.05 <= error_rate, "Too small error rate");
-      static_assert(error_rate <= 0.05, "Too big error rate");
+  /// @brief Kernel clock, oversampling and divider closest to kBaudrate
+  /// @note  Check the result with
+  ///        static_assert(UART::SolveBaudrate<...>().error_ppm == ...)
+  template <uint32_t kBaudrate, rcc::RCCConfigLike kRcc>
+  static consteval usart::BaudSetting SolveBaudrate() {
+    constexpr uint32_t kBusClock =
+        kPeripheralId == 1 ? kRcc::GetAPB2Clock() : kRcc::GetAPB1Clock();
+
+    auto best = usart::SolveBaud(usart::ClockSource::kPCLK, kBusClock,
+                                 kBaudrate);
+    if constexpr (kHasClockSwitch) {
+      for (auto candidate :
+           {usart::SolveBaud(usart::ClockSource::kSYSCLK,
+                             kRcc::GetSystemClock(), kBaudrate),
+            usart::SolveBaud(usart::ClockSource::kHSI,
+                             kRcc::GetClockSource().HSI, kBaudrate)}) {
+        if (usart::IsBetter(candidate, best)) {
+          best = candidate;
+        }
+      }
     }
+    return best;
+  }
 
-    constexpr int kDiv = kBusClock / kBaudrate;
-    static_assert(kDiv < 0x10000, "Too slow baudrate");
+  /// @brief Set the kernel clock and baud rate; call while the USART is off
+  template <uint32_t kBaudrate, rcc::RCCConfigLike kRcc,
+            bool force_init = false>
+  static void Configure() {
+    static constexpr auto kSetting = SolveBaudrate<kBaudrate, kRcc>();
+    static_assert(kSetting.brr != 0, "Baudrate out of range");
+    static_assert(force_init || usart::ErrorScore(kSetting) <=
+                                    usart::kMaxBaudErrorPpm,
+                  "Too big error rate");
 
     *RCCClockRegister() |= usart_clk_en;
-    Instance()->BRR = kDiv;
+
+    if constexpr (kHasClockSwitch) {
+      if constexpr (kSetting.source == usart::ClockSource::kHSI) {
+        RCC->CR |= RCC_CR_HSION;
+        while ((RCC->CR & RCC_CR_HSIRDY) == 0)
+          ;
+      }
+      RCC->CFGR3 = (RCC->CFGR3 & ~(0b11u << kClockSwitchPos)) |
+                   static_cast<uint32_t>(kSetting.source) << kClockSwitchPos;
+    }
+
+    if (kSetting.over8) {
+      Instance()->CR1 |= USART_CR1_OVER8;
+    } else {
+      Instance()->CR1 &= ~USART_CR1_OVER8;
+    }
+    Instance()->BRR = kSetting.brr;
   }
 
   static void Start() {
@@ -115,6 +233,20 @@ class USART {
     Instance()->CR1 &= ~USART_CR1_UE;  // disable Driver
   }
 
+  /// @brief Route the USART interrupt to `handler` instead of HandleRx
+  static void SetIRQHandler(ram_vector::HandlerType handler) {
+    ram_vector::ram_vector[16 + IRQn] = handler;
+
+    NVIC_EnableIRQ(IRQn);
+  }
+
+  /// @brief Let RXNE request the RX DMA channel; IDLE and the receive
+  ///        errors (ORE/NE/FE) raise the USART interrupt
+  static void EnableRxDMA() {
+    Instance()->CR3 |= USART_CR3_DMAR | USART_CR3_EIE;
+    Instance()->CR1 |= USART_CR1_IDLEIE;
+  }
+
   static void EnableRxInterrupt() {
     Instance()->CR1 |= USART_CR1_RXNEIE;
 
@@ -123,6 +255,15 @@ class USART {
     NVIC_EnableIRQ(IRQn);
   }
 
+  /// @brief Let TXE request the TX DMA channel instead of the CPU
+  static void EnableTxDMA() { Instance()->CR3 |= USART_CR3_DMAT; }
+
+  /// @brief Wait until the last byte has left the shift register
+  static void WaitIdle() {
+    while (!(Instance()->ISR & USART_ISR_TC))
+      ;
+  }
+
   static void Write(uint8_t data) {
     while (!(Instance()->ISR & USART_ISR_TXE))
       ;
@@ -132,6 +273,14 @@ class USART {
       ;
   }
 
+  /// @brief Write without waiting for the byte to leave the shift register,
+  ///        so consecutive bytes go out back to back
+  static void WriteBuffered(uint8_t data) {
+    while (!(Instance()->ISR & USART_ISR_TXE))
+      ;
+    Instance()->TDR = data;
+  }
+
   template <typename T>
   requires(sizeof(T) == 1) static void Write(T* data, size_t len) {
     while (len) {
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include <f3/critical_section.hpp>
+#include <f3/peripherals/dma.hpp>
+#include <f3/ram_vector.hpp>
+
+namespace stm32f3 {
+struct USARTRxStatistic {
+  uint32_t bytes;           // Received into the buffer
+  uint32_t dropped;         // Overwritten before the consumer read them
+  uint32_t overrun_errors;  // ORE: a byte was lost before the DMA took it
+  uint32_t noise_errors;    // NE
+  uint32_t framing_errors;  // FE
+  uint32_t dma_errors;      // TE: the channel was restarted, unread bytes lost
+};
+
+/// @brief USART receiver running into a circular DMA buffer
+/// @details The DMA fills the buffer without interrupts per byte. The
+///          USART IDLE interrupt (one character time of silence) and the
+///          DMA half/complete interrupts publish what arrived, so a message
+///          becomes visible right after its last byte and the write position
+///          is observed at least twice per lap. Consumers read in place:
+///          Peek() returns the next contiguous span, Consume() releases it.
+///          One consumer; kSize bytes of slack before data is overwritten.
+///          A lapped consumer resumes kSize / 2 bytes (one published half)
+///          behind the DMA, away from the position it writes next.
+/// @tparam UART stm32f3::USART<...>
+template <typename UART, size_t kSize>
+class USARTRxDMA {
+  static_assert((kSize & (kSize - 1)) == 0, "Size must be a power of two");
+  static_assert(kSize <= 0xFFFF, "CNDTR is 16 bits");
+
+  using Dma = stm32f3::DMA<1>;
+  static constexpr int kChannel = UART::kRxDMAChannel;
+
+  static inline std::array<uint8_t, kSize> buffer_ = {};
+  static inline uint32_t head_ = 0;  // Bytes published, free running
+  static inline uint32_t tail_ = 0;  // Bytes consumed, free running
+  static inline USARTRxStatistic statistic_ = {};
+
+  static DMA_Channel_TypeDef* Channel() { return Dma::ChannelBase(kChannel); }
+
+  /// @brief Advance head_ to the DMA write position
+  static void Publish() {
+    CriticalSection lock;
+    uint32_t position = kSize - Channel()->CNDTR;
+    auto received = (position - head_) % kSize;
+    head_ += received;
+    statistic_.bytes += received;
+
+    // The DMA lapped the consumer (or is about to write at tail_): keep
+    // the newest half, which it is not overwriting
+    if (head_ - tail_ >= kSize) {
+      statistic_.dropped += head_ - tail_ - kSize / 2;
+      tail_ = head_ - kSize / 2;
+    }
+  }
+
+  /// @brief (Re)start the circular transfer at the start of the buffer
+  static void Arm() {
+    Channel()->CCR = 0;
+    Channel()->CMAR =
+        static_cast<uint32_t>(reinterpret_cast<uintptr_t>(buffer_.data()));
+    Channel()->CNDTR = kSize;
+    Channel()->CCR = DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_HTIE |
+                     DMA_CCR_TCIE | DMA_CCR_TEIE | DMA_CCR_EN;
+  }
+
+  static void DMA_IRQHandler() {
+    auto flags = Dma::Flags(kChannel);
+    Dma::ClearFlags(kChannel, Dma::kGlobalFlag | Dma::kCompleteFlag |
+                                  Dma::kHalfFlag | Dma::kErrorFlag);
+    if (!(flags & Dma::kErrorFlag)) {
+      Publish();
+      return;
+    }
+
+    // The hardware disabled the channel: restart it at offset 0 and drop
+    // what was not read, the buffer is overwritten from the start
+    CriticalSection lock;
+    statistic_.dma_errors++;
+    statistic_.dropped += head_ - tail_;
+    head_ += (kSize - head_ % kSize) % kSize;
+    tail_ = head_;
+    Arm();
+  }
+
+  static void USART_IRQHandler() {
+    auto usart = UART::Instance();
+    auto isr = usart->ISR;
+    if (isr & USART_ISR_ORE) {
+      statistic_.overrun_errors++;
+    }
+    if (isr & USART_ISR_NE) {
+      statistic_.noise_errors++;
+    }
+    if (isr & USART_ISR_FE) {
+      statistic_.framing_errors++;
+    }
+    usart->ICR =
+        USART_ICR_IDLECF | USART_ICR_ORECF | USART_ICR_NCF | USART_ICR_FECF;
+    Publish();
+  }
+
+ public:
+  /// @brief Start receiving; call after UART::Configure
+  static void Init() {
+    Dma::Init();
+    Channel()->CCR = 0;
+    Channel()->CPAR = static_cast<uint32_t>(
+        reinterpret_cast<uintptr_t>(&UART::Instance()->RDR));
+    Arm();
+
+    auto irqn = Dma::ChannelIRQn(kChannel);
+    ram_vector::ram_vector[16 + irqn] = &USARTRxDMA::DMA_IRQHandler;
+    NVIC_EnableIRQ(irqn);
+
+    UART::SetIRQHandler(&USARTRxDMA::USART_IRQHandler);
+    UART::EnableRxDMA();
+  }
+
+  /// @brief Received bytes up to the end of the buffer (may be empty)
+  /// @note  Valid until Consume(); read it before kSize more bytes arrive
+  static std::span<uint8_t const> Peek() {
+    Publish();
+    CriticalSection lock;
+    auto start = tail_ % kSize;
+    auto length = std::min<size_t>(head_ - tail_, kSize - start);
+    return {buffer_.data() + start, length};
+  }
+
+  static void Consume(size_t length) {
+    CriticalSection lock;
+    tail_ += std::min<size_t>(length, head_ - tail_);
+  }
+
+  static bool TryRead(uint8_t& c) {
+    auto span = Peek();
+    if (span.empty()) {
+      return false;
+    }
+    c = span[0];
+    Consume(1);
+    return true;
+  }
+
+  static USARTRxStatistic GetStatistic() {
+    CriticalSection lock;
+    return statistic_;
+  }
+};
+}  // namespace stm32f3
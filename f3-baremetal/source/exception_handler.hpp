@@ -1,8 +1,8 @@
 #pragma once
 
 #include <cstdint>
-#include <cstdio>
 
+#include <f3/format.hpp>
 #include <f3/ram_vector.hpp>
 #include <optional>
 
@@ -14,12 +14,12 @@ struct FaultStatus {
   std::optional<uint32_t> mem_fault_address;
 
   void Show() {
-    printf("\x1b[1;31m===== Exception =====\x1b[0K\x1b[m\n");
+    stm32f3::Print<"\x1b[1;31m===== Exception =====\x1b[0K\x1b[m\n">();
     if (bus_fault_address) {
-      printf("BusFault address: %08x\n", *bus_fault_address);
+      stm32f3::Print<"BusFault address: {:08x}\n">(*bus_fault_address);
     }
     if (mem_fault_address) {
-      printf("MemFault address: %08x\n", *mem_fault_address);
+      stm32f3::Print<"MemFault address: {:08x}\n">(*mem_fault_address);
     }
   }
 };
@@ -46,22 +46,22 @@ bool DiagnoseBUsFault() {
     return false;
   }
 
-  printf("BusFault: ");
+  stm32f3::Print<"BusFault: ">();
   if (bfsr & SCB_CFSR_LSPERR_Msk) {
-    printf("Bus fault on floating-point lazy state preservation");
+    stm32f3::Print<"Bus fault on floating-point lazy state preservation">();
   } else if (bfsr & SCB_CFSR_STKERR_Msk) {
-    printf("Bus fault on stacking for exception entry");
+    stm32f3::Print<"Bus fault on stacking for exception entry">();
   } else if (bfsr & SCB_CFSR_UNSTKERR_Msk) {
-    printf("Bus fault on unstacking for a return from exception");
+    stm32f3::Print<"Bus fault on unstacking for a return from exception">();
   } else if (bfsr & SCB_CFSR_IMPRECISERR_Msk) {
-    printf("Imprecise data bus error");
+    stm32f3::Print<"Imprecise data bus error">();
   } else if (bfsr & SCB_CFSR_PRECISERR_Msk) {
-    printf("Precise data bus error");
+    stm32f3::Print<"Precise data bus error">();
   } else if (bfsr & SCB_CFSR_IBUSERR_Msk) {
-    printf("Instruction bus error");
+    stm32f3::Print<"Instruction bus error">();
   }
 
-  printf("\x1b[0K\n");
+  stm32f3::Print<"\x1b[0K\n">();
 
   return true;
 }
@@ -71,22 +71,22 @@ bool DiagnoseMemManage() {
     return false;
   }
 
-  printf("MemoryManagementFault: ");
+  stm32f3::Print<"MemoryManagementFault: ">();
   if (mmfsr & SCB_CFSR_MLSPERR_Msk) {
-    printf("floating-point lazy state preservation");
+    stm32f3::Print<"floating-point lazy state preservation">();
   } else if (mmfsr & SCB_CFSR_MSTKERR_Msk) {
-    printf("stacking for exception entry");
+    stm32f3::Print<"stacking for exception entry">();
   } else if (mmfsr & SCB_CFSR_MUNSTKERR_Msk) {
-    printf("unstacking for a return from exception");
+    stm32f3::Print<"unstacking for a return from exception">();
   } else if (mmfsr & SCB_CFSR_DACCVIOL_Msk) {
-    printf("Data access violation");
+    stm32f3::Print<"Data access violation">();
   } else if (mmfsr & SCB_CFSR_IACCVIOL_Msk) {
-    printf("Instruction access violation");
+    stm32f3::Print<"Instruction access violation">();
   } else {
-    printf("Unknown reason (%08x)", mmfsr);
+    stm32f3::Print<"Unknown reason ({:08x})">(mmfsr);
   }
 
-  printf("\x1b[0K\n");
+  stm32f3::Print<"\x1b[0K\n">();
 
   return true;
 }
@@ -96,42 +96,42 @@ bool DiagnoseUsageFault() {
     return false;
   }
 
-  printf("UsageFault: ");
+  stm32f3::Print<"UsageFault: ">();
   if (ufsr & SCB_CFSR_DIVBYZERO_Msk) {
-    printf("Divide by zero");
+    stm32f3::Print<"Divide by zero">();
   } else if (ufsr & SCB_CFSR_UNALIGNED_Msk) {
-    printf("Unaligned access");
+    stm32f3::Print<"Unaligned access">();
   } else if (ufsr & SCB_CFSR_NOCP_Msk) {
-    printf("No coprocessor");
+    stm32f3::Print<"No coprocessor">();
   } else if (ufsr & SCB_CFSR_INVPC_Msk) {
-    printf("Invalid PC load");
+    stm32f3::Print<"Invalid PC load">();
   } else if (ufsr & SCB_CFSR_INVSTATE_Msk) {
-    printf("Invalid state");
+    stm32f3::Print<"Invalid state">();
   } else if (ufsr & SCB_CFSR_UNDEFINSTR_Msk) {
-    printf("Undefined instruction");
+    stm32f3::Print<"Undefined instruction">();
   } else {
-    printf("Unknown reason (%08x)", ufsr);
+    stm32f3::Print<"Unknown reason ({:08x})">(ufsr);
   }
 
-  printf("\x1b[0K\n");
+  stm32f3::Print<"\x1b[0K\n">();
 
   return true;
 }
 
 bool DiagnoseHardFault() {
   auto hfsr = SCB->HFSR;
-  printf("HardFault (%08x)\x1b[0K\n", hfsr);
+  stm32f3::Print<"HardFault ({:08x})\x1b[0K\n">(hfsr);
   if (hfsr & SCB_HFSR_VECTTBL_Msk) {
-    printf("Vector Table HardFault\x1b[0K\n");
+    stm32f3::Print<"Vector Table HardFault\x1b[0K\n">();
     return true;
   }
   if (hfsr & SCB_HFSR_DEBUGEVT_Msk) {
-    printf("Debug Event HardFault\x1b[0K\n");
+    stm32f3::Print<"Debug Event HardFault\x1b[0K\n">();
     return true;
   }
   if (hfsr & SCB_HFSR_FORCED_Msk) {
     auto cfsr = SCB->CFSR;
-    printf("Forced HardFault (cfsr: %08x)\x1b[0K\n", cfsr);
+    stm32f3::Print<"Forced HardFault (cfsr: {:08x})\x1b[0K\n">(cfsr);
 
     if (DiagnoseBUsFault())
       return true;
@@ -142,7 +142,7 @@ bool DiagnoseHardFault() {
     if (DiagnoseUsageFault())
       return true;
 
-    printf("Unknown reason (%08x)", cfsr);
+    stm32f3::Print<"Unknown reason ({:08x})">(cfsr);
   }
 
   return false;
@@ -152,6 +152,7 @@ bool DiagnoseHardFault() {
   DumpFaultStatus();
   DiagnoseHardFault();
 
+  stm32f3::FlushConsole();
   while (true)
     ;
 }
@@ -160,6 +161,7 @@ bool DiagnoseHardFault() {
   DumpFaultStatus();
   DiagnoseBUsFault();
 
+  stm32f3::FlushConsole();
   while (true)
     ;
 }
@@ -168,6 +170,7 @@ bool DiagnoseHardFault() {
   DumpFaultStatus();
   DiagnoseMemManage();
 
+  stm32f3::FlushConsole();
   while (true)
     ;
 }
@@ -176,6 +179,7 @@ bool DiagnoseHardFault() {
   DumpFaultStatus();
   DiagnoseUsageFault();
 
+  stm32f3::FlushConsole();
   while (true)
     ;
 }
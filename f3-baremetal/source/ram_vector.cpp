@@ -1,3 +1,4 @@
+#include <f3/format.hpp>
 #include <f3/ram_vector.hpp>
 
 namespace stm32f3::ram_vector {
@@ -6,7 +7,8 @@ std::array<HandlerType, 0x200 / 4> ram_vector
 
 void DefaultHandler() {
   auto vect_active = SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk;
-  printf("DefaultHandler (active: %ld)", vect_active);
+  stm32f3::Print<"DefaultHandler (active: {})">(vect_active);
+  stm32f3::FlushConsole();
   while (true) {
     asm("nop");
   }
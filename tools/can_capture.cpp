@@ -0,0 +1,211 @@
+#include <array>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+#include "capture_protocol.hpp"
+
+// Converts CANMonitor's binary capture stream (CANMonitor::Capture) to a
+// candump log on stdout and, optionally, a SocketCAN pcap for Wireshark:
+//   stty -F /dev/ttyACM0 raw 2500000
+//   can_capture [--pcap bus.pcap] [--interface can0] [/dev/ttyACM0]
+// Times are seconds since the device booted. Frames the device or the
+// serial line lost are reported on stderr from the Sync counters.
+
+namespace {
+using namespace CANMonitor;
+
+struct Statistic {
+  unsigned long frames;
+  unsigned long syncs;
+  unsigned long corrupt;    // Bad COBS, length or CRC
+  unsigned long unsynced;   // Frames before the first Sync (no time base)
+  unsigned long device_dropped;  // Ring overflows in the device
+  unsigned long overruns;        // CAN RX FIFO overruns in the device
+  unsigned long line_lost;       // Sent by the device, never decoded
+};
+
+class PcapWriter {
+  static constexpr uint32_t kLinkTypeSocketCAN = 227;
+  static constexpr uint32_t kCANExtendedFlag = 0x80000000;
+  static constexpr uint32_t kCANRemoteFlag = 0x40000000;
+
+  FILE* file_;
+
+  void Put32(uint32_t value) { fwrite(&value, 4, 1, file_); }
+  void Put16(uint16_t value) { fwrite(&value, 2, 1, file_); }
+
+ public:
+  explicit PcapWriter(FILE* file) : file_(file) {
+    Put32(0xA1B2C3D4);  // Microsecond timestamps, host byte order
+    Put16(2);
+    Put16(4);
+    Put32(0);   // thiszone
+    Put32(0);   // sigfigs
+    Put32(16);  // snaplen: struct can_frame
+    Put32(kLinkTypeSocketCAN);
+  }
+
+  void Write(uint64_t time_us, capture::Frame const& frame) {
+    Put32(time_us / 1000000);
+    Put32(time_us % 1000000);
+    Put32(16);
+    Put32(16);
+
+    // struct can_frame, can_id in network byte order
+    uint32_t id = frame.id | (frame.extended ? kCANExtendedFlag : 0) |
+                  (frame.remote ? kCANRemoteFlag : 0);
+    uint8_t header[8] = {static_cast<uint8_t>(id >> 24),
+                         static_cast<uint8_t>(id >> 16),
+                         static_cast<uint8_t>(id >> 8),
+                         static_cast<uint8_t>(id), frame.length};
+    fwrite(header, 1, sizeof(header), file_);
+    fwrite(frame.data.data(), 1, frame.data.size(), file_);
+  }
+};
+
+void PrintCandump(uint64_t time_us, char const* interface,
+                  capture::Frame const& frame) {
+  printf("(%" PRIu64 ".%06" PRIu64 ") %s ", time_us / 1000000,
+         time_us % 1000000, interface);
+  printf(frame.extended ? "%08X#" : "%03X#", frame.id);
+  if (frame.remote) {
+    printf(frame.length ? "R%X\n" : "R\n", frame.length);
+    return;
+  }
+  for (size_t i = 0; i < frame.length; i++) {
+    printf("%02X", frame.data[i]);
+  }
+  printf("\n");
+}
+
+void Usage(char const* name) {
+  fprintf(stderr, "usage: %s [--pcap FILE] [--interface NAME] [INPUT]\n",
+          name);
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  char const* input_path = nullptr;
+  char const* pcap_path = nullptr;
+  char const* interface = "can0";
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 < argc && strcmp(argv[i], "--pcap") == 0) {
+      pcap_path = argv[++i];
+    } else if (i + 1 < argc && strcmp(argv[i], "--interface") == 0) {
+      interface = argv[++i];
+    } else if (argv[i][0] != '-' && input_path == nullptr) {
+      input_path = argv[i];
+    } else {
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+
+  FILE* input = input_path ? fopen(input_path, "rb") : stdin;
+  if (input == nullptr) {
+    perror(input_path);
+    return 1;
+  }
+
+  FILE* pcap_file = nullptr;
+  PcapWriter* pcap = nullptr;
+  if (pcap_path) {
+    pcap_file = fopen(pcap_path, "wb");
+    if (pcap_file == nullptr) {
+      perror(pcap_path);
+      return 1;
+    }
+    static PcapWriter writer(pcap_file);
+    pcap = &writer;
+  }
+
+  Statistic statistic = {};
+  bool synced = false;
+  uint64_t time_us = 0;
+  capture::Sync last_sync = {};
+  unsigned long frames_since_sync = 0;
+
+  auto handle = [&](capture::Record const& record) {
+    if (record.type == capture::kSyncRecord) {
+      auto const& sync = record.sync;
+      statistic.syncs++;
+      if (!synced) {
+        time_us = sync.time_us;
+        synced = true;
+      } else {
+        time_us += static_cast<int32_t>(
+            sync.time_us - static_cast<uint32_t>(time_us));
+
+        auto dropped = sync.dropped - last_sync.dropped;
+        auto overruns = sync.overruns - last_sync.overruns;
+        auto sent = sync.frames - last_sync.frames;
+        auto lost = sent > frames_since_sync ? sent - frames_since_sync : 0;
+        statistic.device_dropped += dropped;
+        statistic.overruns += overruns;
+        statistic.line_lost += lost;
+        if (dropped || overruns || lost) {
+          fprintf(stderr,
+                  "%" PRIu64 ".%06" PRIu64
+                  ": %u dropped by the device, %u FIFO overruns, %lu lost "
+                  "on the line\n",
+                  time_us / 1000000, time_us % 1000000, dropped, overruns,
+                  lost);
+        }
+      }
+      last_sync = sync;
+      frames_since_sync = 0;
+      return;
+    }
+
+    if (!synced) {
+      statistic.unsynced++;
+      return;
+    }
+    time_us += (record.frame.time_us - time_us) & capture::kMaxGapUs;
+    statistic.frames++;
+    frames_since_sync++;
+    PrintCandump(time_us, interface, record.frame);
+    if (pcap) {
+      pcap->Write(time_us, record.frame);
+    }
+  };
+
+  // Longer packets are not records; drop them up to the next delimiter
+  std::array<uint8_t, 64> packet;
+  size_t size = 0;
+  bool overlong = false;
+  int c;
+  while ((c = fgetc(input)) != EOF) {
+    if (c != 0) {
+      if (size == packet.size()) {
+        overlong = true;
+      } else {
+        packet[size++] = c;
+      }
+      continue;
+    }
+
+    capture::Record record;
+    auto length = overlong ? 0 : capture::CobsDecode(packet.data(), size);
+    if (length > 0 &&
+        capture::DecodeRecord(packet.data(), length, record)) {
+      handle(record);
+    } else if (size > 0 || overlong) {
+      statistic.corrupt++;
+    }
+    size = 0;
+    overlong = false;
+  }
+
+  fprintf(stderr,
+          "%lu frames, %lu syncs, %lu corrupt records, %lu before the "
+          "first sync, %lu dropped by the device, %lu FIFO overruns, %lu "
+          "lost on the line\n",
+          statistic.frames, statistic.syncs, statistic.corrupt,
+          statistic.unsynced, statistic.device_dropped, statistic.overruns,
+          statistic.line_lost);
+  if (pcap_file) {
+    fclose(pcap_file);
+  }
+}
@@ -0,0 +1,114 @@
+#include <cstdint>
+#include <cstdio>
+
+#include "can_id_table.hpp"
+
+//* CANIdTable::ForEachSnapshot against an interrupting writer
+//  The value's copy assignment hands control to a simulated RX interrupt
+//  halfway through copying the live slot, the way the real interrupt can
+//  preempt the copy loop. Every snapshot must be one that the writer
+//  actually left behind. Exits with 1 on the first torn snapshot.
+
+namespace {
+/// Written as CanDebug does it: the generation first, then the fields
+struct Entry {
+  uint32_t head = 0;
+  uint16_t generation = 0;
+  uint32_t tail = 0;
+
+  // Simulated interrupt, run once while copying from `source`
+  static inline Entry const* source = nullptr;
+  static inline void (*interrupt)() = nullptr;
+
+  Entry() = default;
+  Entry(Entry const&) = default;
+  Entry& operator=(Entry const& other) {
+    head = other.head;
+    if (&other == source && interrupt != nullptr && host::primask == 0) {
+      auto isr = interrupt;
+      interrupt = nullptr;
+      isr();
+    }
+    generation = other.generation;
+    tail = other.tail;
+    return *this;
+  }
+
+  [[nodiscard]] uint32_t Generation() const { return generation; }
+  [[nodiscard]] bool Consistent() const {
+    return head == tail && tail == generation * 7u;
+  }
+};
+
+using Table = CANMonitor::CANIdTable<Entry, 1, 1>;
+Table table;
+uint32_t next_id = 0x100;
+int storm = 0;  // Interrupts still to come, one per copy attempt
+
+void Update(Entry& entry) {
+  entry.generation++;
+  entry.head = entry.generation * 7u;
+  entry.tail = entry.generation * 7u;
+}
+
+/// An RX interrupt for the identifier in the slot
+void Receive() {
+  Update(*table.FindOrInsert(next_id, false).first);
+  if (--storm > 0) {
+    Entry::interrupt = Receive;
+  }
+}
+
+/// An RX interrupt for a new identifier that evicts the slot
+void Evict() {
+  table.Age();
+  auto [entry, result] = table.FindOrInsert(++next_id, false);
+  if (result != CANMonitor::CANIdInsert::kEvicted) {
+    printf("setup: slot was not evicted\n");
+  }
+  Update(*entry);
+}
+
+bool Check(char const* name, void (*isr)(), int interrupts) {
+  Entry::source = table.Find(next_id, false);
+  Entry::interrupt = isr;
+  storm = interrupts;
+
+  bool ok = true;
+  int visited = 0;
+  table.ForEachSnapshot([&](size_t, uint32_t id, bool, Entry const& value) {
+    visited++;
+    if (!value.Consistent()) {
+      printf("%s: torn snapshot (head %u, generation %u, tail %u)\n", name,
+             (unsigned)value.head, (unsigned)value.generation,
+             (unsigned)value.tail);
+      ok = false;
+    }
+    if (id != next_id) {
+      printf("%s: stale identifier 0x%X\n", name, (unsigned)id);
+      ok = false;
+    }
+  });
+  if (visited != 1) {
+    printf("%s: %d entries visited\n", name, visited);
+    ok = false;
+  }
+  if (host::primask != 0) {
+    printf("%s: interrupts left masked\n", name);
+    ok = false;
+  }
+  Entry::interrupt = nullptr;
+  return ok;
+}
+}  // namespace
+
+int main() {
+  table.Clear();
+  Update(*table.FindOrInsert(next_id, false).first);
+
+  bool ok = Check("update during the copy", Receive, 1);
+  ok = Check("update during every attempt", Receive, 100) && ok;
+  ok = Check("eviction during the copy", Evict, 1) && ok;
+  puts(ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,44 @@
+#include <cstdio>
+
+#include <f3/peripherals/can_analysis.hpp>
+
+#include "schedule.hpp"
+
+/// @brief Stable text report (diff it between firmware revisions)
+template <size_t N>
+void PrintReport(stm32f3::can::CANScheduleAnalysis<N> const& result) {
+  using Analysis = stm32f3::can::CANScheduleAnalysis<N>;
+  auto bitrate = result.bitrate;
+
+  auto load_ppm = result.utilization_ppm;
+  printf("CAN schedule @ %lu bit/s: load %lu.%03lu %%, %s\n",
+         (unsigned long)bitrate, (unsigned long)(load_ppm / 10000),
+         (unsigned long)(load_ppm / 10 % 1000),
+         result.schedulable ? "schedulable" : "NOT SCHEDULABLE");
+  printf("  rx: %lu.%03lu frames/s accepted\n",
+         (unsigned long)(result.rx_frames_per_ks / 1000),
+         (unsigned long)(result.rx_frames_per_ks % 1000));
+  printf("  %-10s %-3s %3s %8s %6s %8s\n", "id", "fmt", "dlc", "T[us]",
+         "C[us]", "R[us]");
+  for (auto const& m : result.messages) {
+    printf("  0x%08lX %-3s %3u %8lu %6lu ", (unsigned long)m.message.id,
+           m.message.extended ? "ext" : "std", (unsigned int)m.message.length,
+           (unsigned long)Analysis::BitsToUs(m.deadline_bits, bitrate),
+           (unsigned long)Analysis::BitsToUs(m.frame_bits, bitrate));
+    if (m.response_bits == Analysis::kUnbounded) {
+      printf("%8s ", "inf");
+    } else {
+      printf("%8lu ",
+             (unsigned long)Analysis::BitsToUs(m.response_bits, bitrate));
+    }
+    printf("%s%s%s\n", m.local ? "tx" : "--", m.received ? " rx" : "",
+           m.schedulable ? "" : " MISS");
+  }
+}
+
+// Prints the worst-case response time report of CANMonitor's schedule
+int main() {
+  using namespace CANMonitor::schedule;
+
+  PrintReport(stm32f3::can::CANBusAnalysis<kBitrate, Table>::kResult);
+}
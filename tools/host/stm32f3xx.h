@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+
+// Host stand-ins for the CMSIS intrinsics that header-only code under test
+// uses. PRIMASK is a plain flag, so a test can model an interrupt that is
+// held off while it is set.
+
+namespace host {
+inline uint32_t primask = 0;
+}  // namespace host
+
+inline uint32_t __get_PRIMASK() { return host::primask; }
+inline void __set_PRIMASK(uint32_t primask) { host::primask = primask; }
+inline void __disable_irq() { host::primask = 1; }
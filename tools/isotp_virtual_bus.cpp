@@ -0,0 +1,276 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <vector>
+
+#include <f3/peripherals/can_analysis.hpp>
+#include <f3/peripherals/can_isotp.hpp>
+
+//* ISO-TP over a virtual bus
+//  Two ISOTPLinks talk through a simulated 1 Mbit/s bus: one frame on the
+//  wire at a time, arbitration by identifier, exact frame lengths (stuff
+//  bits included) and TX completion reported back to the sending link. The
+//  links are polled every 100 us, also while a frame is on the wire, and
+//  optional higher priority traffic delays their frames in the queue.
+//  Every payload length 0..4095 is sent for a few block size / STmin
+//  settings; the received data, the peer's block size and STmin (from the
+//  end of a CF to the start of the next) are checked, and the throughput of
+//  the longest payload is reported. Exits with 1 on the first failure.
+
+namespace {
+using stm32f3::can::ISOTPConfig;
+using stm32f3::can::ISOTPError;
+
+constexpr uint32_t kRequestId = 0x7E0;
+constexpr uint32_t kResponseId = 0x7E8;
+constexpr uint32_t kLoadId = 0x100;      // Background traffic (node 2)
+constexpr uint32_t kLoadPeriodUs = 260;  // ~50 % load with 8-byte frames
+constexpr uint32_t kIdleStepUs = 100;  // Idle bus time step (STmin resolution)
+
+struct Message {
+  uint32_t id = 0;
+  uint32_t length = 0;
+  std::array<uint8_t, 8> data = {};
+  bool extended = false;
+  bool remote = false;
+};
+
+struct Transmission {
+  int node;
+  Message message;
+  uint32_t start_us;
+  uint32_t end_us;
+};
+
+class VirtualBus {
+  std::array<std::deque<Message>, 3> queues_;  // TX queue per node
+
+ public:
+  uint32_t now_us = 0;
+  bool busy = false;
+  Transmission wire = {};
+
+  bool Queue(int node, Message const& message) {
+    queues_[node].push_back(message);
+    return true;  // Unbounded, like a deep software TX queue
+  }
+
+  [[nodiscard]] size_t Pending(int node) const {
+    return queues_[node].size() + (busy && wire.node == node ? 1 : 0);
+  }
+
+  /// @brief Put the highest priority queued frame on the wire
+  bool Arbitrate() {
+    int winner = -1;
+    for (int node = 0; node < 3; node++) {
+      if (queues_[node].empty()) {
+        continue;
+      }
+      if (winner < 0 ||
+          queues_[node].front().id < queues_[winner].front().id) {
+        winner = node;
+      }
+    }
+    if (winner < 0) {
+      return false;
+    }
+
+    auto message = queues_[winner].front();
+    queues_[winner].pop_front();
+    auto bits = stm32f3::can::CANFrameBits(
+        message.id, message.extended, message.remote,
+        static_cast<uint8_t>(message.length), message.data.data());
+    wire = {.node = winner,
+            .message = message,
+            .start_us = now_us,
+            .end_us = now_us + bits};  // 1 bit = 1 us
+    busy = true;
+    return true;
+  }
+
+  void Clear() {
+    for (auto& queue : queues_) {
+      queue.clear();
+    }
+    busy = false;
+  }
+};
+
+VirtualBus bus;
+
+template <int kNode>
+struct Node {
+  using Message = ::Message;
+  static bool Send(Message const& message) {
+    return bus.Queue(kNode, message);
+  }
+};
+
+using Tester = stm32f3::can::ISOTPLink<Node<0>, kRequestId, kResponseId>;
+using Target = stm32f3::can::ISOTPLink<Node<1>, kResponseId, kRequestId>;
+
+struct Result {
+  bool ok;
+  uint32_t duration_us;
+};
+
+/// @param rx_first Dispatch a frame to the receiving node before reporting
+///        its TX completion (interrupt order is not guaranteed)
+Result Transfer(ISOTPConfig const& config, std::vector<uint8_t> const& payload,
+                bool rx_first, bool loaded) {
+  Tester tester(config);
+  Target target(config);
+  std::vector<uint8_t> buffer(stm32f3::can::isotp::kMaxPayload);
+
+  bus.Clear();
+  auto start_us = bus.now_us;
+  target.Receiver().Listen(buffer);
+  if (!tester.Sender().Start(payload)) {
+    return {.ok = false, .duration_us = 0};
+  }
+
+  auto st_min_us = stm32f3::can::isotp::STminToMicros(config.st_min);
+  uint32_t cf_end_us = 0;
+  bool cf_before = false;  // The last frame of the tester was a CF
+  size_t block = 0;        // CFs since the last flow control
+  uint32_t load_due_us = start_us;
+
+  auto fail = [&](char const* what) {
+    printf("  length %zu: %s\n", payload.size(), what);
+    return Result{.ok = false, .duration_us = 0};
+  };
+
+  while (tester.Sender().Busy()) {
+    if (bus.now_us - start_us > 60000000) {
+      return fail("no progress");
+    }
+    if (loaded && bus.now_us - load_due_us < 0x80000000) {
+      bus.Queue(2, {.id = kLoadId, .length = 8});
+      load_due_us += kLoadPeriodUs;
+    }
+
+    tester.Poll(bus.now_us);
+    target.Poll(bus.now_us);
+    if (bus.Pending(0) > 1) {
+      return fail("more than one frame of the sender queued");
+    }
+
+    if (!bus.busy && bus.Arbitrate()) {
+      auto const& tx = bus.wire;
+      auto pci = tx.message.data[0] >> 4;
+      if (tx.node == 0 && pci == 0x2) {
+        if (cf_before && tx.start_us - cf_end_us < st_min_us) {
+          return fail("STmin violated");
+        }
+        if (config.block_size != 0 && ++block > config.block_size) {
+          return fail("block size exceeded");
+        }
+      } else if (tx.node == 1 && pci == 0x3) {
+        block = 0;
+        cf_before = false;
+      }
+    }
+    if (!bus.busy) {
+      bus.now_us += kIdleStepUs;
+      continue;
+    }
+
+    auto const& tx = bus.wire;
+    bus.now_us = std::min(bus.now_us + kIdleStepUs, tx.end_us);
+    if (bus.now_us != tx.end_us) {
+      continue;
+    }
+
+    bus.busy = false;
+    auto pci = tx.message.data[0] >> 4;
+    if (tx.node == 0 && pci == 0x2) {
+      cf_before = true;
+      cf_end_us = tx.end_us;
+    }
+    auto complete = [&] {
+      if (tx.node == 0) {
+        tester.HandleTxComplete(tx.message, bus.now_us);
+      } else if (tx.node == 1) {
+        target.HandleTxComplete(tx.message, bus.now_us);
+      }
+    };
+    auto receive = [&] {
+      if (tx.node == 0) {
+        target.HandleRx(tx.message, bus.now_us);
+      } else {
+        tester.HandleRx(tx.message, bus.now_us);
+      }
+    };
+    if (rx_first) {
+      receive();
+      complete();
+    } else {
+      complete();
+      receive();
+    }
+  }
+
+  if (tester.Sender().GetState() != stm32f3::can::ISOTPSender::State::kDone) {
+    return fail("sender failed");
+  }
+  if (!target.Receiver().Done()) {
+    return fail("receiver not done");
+  }
+  auto data = target.Receiver().Data();
+  if (data.size() != payload.size() ||
+      !std::equal(data.begin(), data.end(), payload.begin())) {
+    return fail("payload mismatch");
+  }
+  return {.ok = true, .duration_us = bus.now_us - start_us};
+}
+}  // namespace
+
+int main() {
+  struct Case {
+    char const* name;
+    ISOTPConfig config;
+    bool loaded;
+  };
+  std::array<Case, 5> const cases = {{
+      {"BS 0, STmin 0", {.block_size = 0, .st_min = 0}, false},
+      {"BS 8, STmin 0", {.block_size = 8, .st_min = 0}, false},
+      {"BS 1, STmin 500 us", {.block_size = 1, .st_min = 0xF5}, false},
+      {"BS 4, STmin 2 ms", {.block_size = 4, .st_min = 2}, false},
+      {"BS 2, STmin 300 us, 50 % load", {.block_size = 2, .st_min = 0xF3},
+       true},
+  }};
+
+  // Length 0 is refused up front
+  {
+    stm32f3::can::ISOTPSender sender;
+    if (sender.Start({}) || sender.GetError() != ISOTPError::kEmptyPayload) {
+      printf("empty payload was not refused\n");
+      return 1;
+    }
+  }
+
+  for (auto const& c : cases) {
+    Result longest = {};
+    for (size_t length = 1; length <= stm32f3::can::isotp::kMaxPayload;
+         length++) {
+      std::vector<uint8_t> payload(length);
+      for (size_t i = 0; i < length; i++) {
+        payload[i] = static_cast<uint8_t>(i * 7 + length);
+      }
+
+      auto result = Transfer(c.config, payload, length % 2 == 0, c.loaded);
+      if (!result.ok) {
+        printf("%s: FAILED\n", c.name);
+        return 1;
+      }
+      longest = result;
+    }
+
+    auto bytes_per_s = uint64_t{stm32f3::can::isotp::kMaxPayload} * 1000000 /
+                       longest.duration_us;
+    printf("%-30s ok, 4095 bytes in %6.1f ms (%5lu B/s)\n", c.name,
+           longest.duration_us / 1000.0, (unsigned long)bytes_per_s);
+  }
+}
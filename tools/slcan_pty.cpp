@@ -0,0 +1,213 @@
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <random>
+
+#include <f3/peripherals/can_analysis.hpp>
+
+#include "slcan_protocol.hpp"
+
+// Runs CANMonitor's SLCAN engine behind a pseudo-terminal, with a simulated
+// bus, to exercise slcand/can-utils and the console bandwidth without the
+// board:
+//   slcan_pty --load 90 --baud 2500000
+//   slcand -o -s8 /dev/pts/N slcan0 && ip link set up slcan0 && candump slcan0
+// Frames the serial line cannot keep up with are dropped from a ring of the
+// firmware's depth and reported as overruns.
+
+namespace {
+using Clock = std::chrono::steady_clock;
+using CANMonitor::SLCANFrame;
+
+constexpr size_t kRxRingDepth = 64;  // Same as CANMonitor::SLCAN
+
+struct RxEntry {
+  SLCANFrame frame;
+  uint16_t time_ms;
+};
+
+struct Statistic {
+  unsigned long bus_frames;
+  unsigned long sent_frames;  // Host -> bus
+  unsigned long written_bytes;
+  unsigned long overruns;
+};
+
+std::deque<RxEntry> rx_ring;
+Statistic statistic = {};
+
+struct HostDevice {
+  static inline bool open = false;
+  static inline bool listen_only = false;
+  static inline uint32_t bitrate = 0;
+  static inline unsigned long reported_overruns = 0;
+
+  static bool Open(uint32_t bitrate, bool listen_only) {
+    HostDevice::bitrate = bitrate;
+    HostDevice::listen_only = listen_only;
+    open = true;
+    fprintf(stderr, "open: %u bit/s%s\n", bitrate,
+            listen_only ? " (listen only)" : "");
+    return true;
+  }
+
+  static void Close() {
+    open = false;
+    rx_ring.clear();
+    fprintf(stderr, "close\n");
+  }
+
+  static bool Send(SLCANFrame const&) {
+    statistic.sent_frames++;
+    return true;
+  }
+
+  static uint8_t StatusFlags() {
+    uint8_t flags = 0;
+    if (rx_ring.size() == kRxRingDepth) {
+      flags |= CANMonitor::kSLCANRxFull;
+    }
+    if (statistic.overruns != reported_overruns) {
+      flags |= CANMonitor::kSLCANDataOverrun;
+    }
+    reported_overruns = statistic.overruns;
+    return flags;
+  }
+};
+
+SLCANFrame RandomFrame(std::mt19937& random) {
+  SLCANFrame frame{};
+  frame.extended = random() % 4 == 0;
+  frame.remote = random() % 32 == 0;
+  frame.id = random() & (frame.extended ? 0x1FFFFFFF : 0x7FF);
+  frame.length = random() % 9;
+  for (auto& byte : frame.data) {
+    byte = random();
+  }
+  return frame;
+}
+
+uint32_t FrameBits(SLCANFrame const& frame) {
+  return stm32f3::can::CANFrameBits(frame.id, frame.extended, frame.remote,
+                                    frame.length, frame.data.data());
+}
+
+void Usage(char const* name) {
+  fprintf(stderr, "usage: %s [--load PERCENT] [--baud BAUDRATE]\n", name);
+  exit(1);
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  double load = 50;
+  double baudrate = 2500000;
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 < argc && strcmp(argv[i], "--load") == 0) {
+      load = atof(argv[++i]);
+    } else if (i + 1 < argc && strcmp(argv[i], "--baud") == 0) {
+      baudrate = atof(argv[++i]);
+    } else {
+      Usage(argv[0]);
+    }
+  }
+
+  int pty = posix_openpt(O_RDWR | O_NOCTTY);
+  if (pty < 0 || grantpt(pty) != 0 || unlockpt(pty) != 0) {
+    perror("posix_openpt");
+    return 1;
+  }
+  fcntl(pty, F_SETFL, fcntl(pty, F_GETFL) | O_NONBLOCK);
+  printf("%s\n", ptsname(pty));
+  fflush(stdout);
+
+  CANMonitor::SLCANProtocol<HostDevice> protocol;
+  auto reply = [&](char const* data, size_t length) {
+    if (write(pty, data, length) > 0) {
+      statistic.written_bytes += length;
+    }
+  };
+
+  std::mt19937 random(1);
+  auto start = Clock::now();
+  auto last = start;
+  auto last_report = start;
+  double bus_bits = 0;     // Bit times available on the simulated bus
+  double serial_bytes = 0;  // Byte times available on the serial line
+  auto pending = RandomFrame(random);
+
+  while (true) {
+    pollfd fd = {.fd = pty, .events = POLLIN, .revents = 0};
+    poll(&fd, 1, 1);
+
+    char input[64];
+    auto n = read(pty, input, sizeof(input));
+    for (ssize_t i = 0; i < n; i++) {
+      protocol.Input(input[i], reply);
+    }
+
+    auto now = Clock::now();
+    auto elapsed = std::chrono::duration<double>(now - last).count();
+    last = now;
+    auto time_ms = static_cast<uint16_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(now - start)
+            .count() %
+        CANMonitor::slcan::kTimestampWrapMs);
+
+    if (HostDevice::open) {
+      auto drain = [&] {
+        while (!rx_ring.empty()) {
+          char line[CANMonitor::slcan::kMaxLine];
+          auto length =
+              CANMonitor::slcan::Encode(rx_ring.front().frame,
+                                        protocol.Timestamps(),
+                                        rx_ring.front().time_ms, line);
+          if (serial_bytes < length) {
+            return;
+          }
+          serial_bytes -= length;
+          rx_ring.pop_front();
+          reply(line, length);
+        }
+        // Line idle time is not saved up: the UART cannot send ahead
+        serial_bytes = std::min(serial_bytes, 1.0);
+      };
+
+      // The serial line is credited with the bus time of each frame, so a
+      // late wake-up does not deliver a burst before the serial side drains
+      bus_bits += elapsed * HostDevice::bitrate * load / 100;
+      while (bus_bits >= FrameBits(pending)) {
+        auto bits = FrameBits(pending);
+        bus_bits -= bits;
+        serial_bytes += bits * 100 / load / HostDevice::bitrate * baudrate / 10;
+        drain();
+
+        statistic.bus_frames++;
+        if (rx_ring.size() == kRxRingDepth) {
+          statistic.overruns++;
+        } else {
+          rx_ring.push_back({pending, time_ms});
+        }
+        pending = RandomFrame(random);
+      }
+    } else {
+      bus_bits = 0;
+      serial_bytes = 0;
+    }
+
+    if (now - last_report >= std::chrono::seconds(1)) {
+      last_report = now;
+      fprintf(stderr,
+              "bus %lu frames, host %lu frames, %lu bytes out, "
+              "%lu overruns, ring %zu\n",
+              statistic.bus_frames, statistic.sent_frames,
+              statistic.written_bytes, statistic.overruns, rx_ring.size());
+    }
+  }
+}